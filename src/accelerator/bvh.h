@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "../accelerator/depth.h"
+#include "../geometry/mesh.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/vec3.h"
+#include "../ray/section.h"
+#include "../stats/counters.h"
+
+namespace Accelerator
+{
+
+	// Bounding volume hierarchy, built top down with a binned surface area heuristic
+	// On fast Construction of SAH-based Bounding Volume Hierarchies, 2007
+	// Ingo Wald
+	// Leaves refer to ranges of the mesh, once it is reordered by primitive_ids
+	class BVH final
+	{
+
+	public:
+
+		// Nodes are stored depth first, the first child of an inner node directly follows its parent
+		struct Node
+		{
+			AABB bound;
+			// Inner node: index of second child, leaf: index of first primitive
+			uint32_t offset{ 0 };
+			// Number of primitives, zero for inner nodes
+			uint16_t count{ 0 };
+			// Split axis, used to visit the nearest child first
+			uint8_t axis{ 0 };
+		};
+
+	private:
+
+		// Cost of a node traversal, relative to a primitive intersection
+		static constexpr double traversal_cost{ 1.0 };
+
+		// Number of bins used to evaluate split candidates per axis
+		static constexpr uint8_t n_bin{ 16 };
+
+		// Leaves are split until they hold at most this many primitives
+		static constexpr uint16_t max_leaf{ 4 };
+
+		// A far child is pushed per level, the build keeps leaves within max_depth
+		static constexpr uint8_t max_stack{ Accelerator::max_depth };
+
+		std::vector<Node> node;
+
+		// Index in the mesh at build time, for each primitive in leaf order
+		std::vector<uint32_t> primitive_id;
+
+		// Used during build only
+		struct Reference
+		{
+			AABB bound;
+			Real3 centre;
+			uint32_t id{ 0 };
+		};
+
+	public:
+
+		BVH() {};
+
+		BVH(
+			Geometry::Mesh const& mesh
+		)
+		{
+			if ( mesh.size() == 0 )
+				return;
+
+			std::vector<Reference> reference;
+			reference.reserve( mesh.size() );
+			for ( uint32_t i = 0; i < mesh.size(); ++i )
+			{
+				AABB const bound = mesh[ i ].bound();
+				reference.push_back( { bound, bound.centre(), i } );
+			}
+
+			node.reserve( 2 * mesh.size() );
+			build( reference, 0, static_cast<uint32_t>( reference.size() ), 0 );
+
+			primitive_id.reserve( reference.size() );
+			for ( Reference const& r : reference )
+				primitive_id.push_back( r.id );
+		};
+
+		// Nodes of a tree built before, e.g. read from a scene cache. The mesh is already in leaf order.
+		BVH(
+			std::span<Node const> const& node_data
+		)
+			: node( node_data.begin(), node_data.end() )
+		{};
+
+		// Closest hit, distance and index of the triangle in the reordered mesh
+		std::tuple<bool, Real, uint32_t> intersect(
+			Geometry::Mesh const& mesh,
+			Ray::Section const& ray,
+			Real distance
+		) const
+		{
+			bool f_hit{ false };
+			uint32_t object_id{ 0 };
+			if ( node.empty() )
+				return { f_hit, distance, object_id };
+
+			Real3 const inv_direction( 1.0 / ray.direction.x, 1.0 / ray.direction.y, 1.0 / ray.direction.z );
+			bool const f_negative[ 3 ] = { inv_direction.x < 0., inv_direction.y < 0., inv_direction.z < 0. };
+
+			std::array<uint32_t, max_stack> stack;
+			uint8_t n_stack{ 0 };
+			uint32_t current{ 0 };
+			while ( 1 )
+			{
+				Node const& n = node[ current ];
+				if ( n.bound.intersect( ray.origin, inv_direction, distance ) >= 0. )
+				{
+					if ( n.count > 0 )
+					{
+						for ( uint32_t i = n.offset; i < n.offset + n.count; ++i )
+						{
+							BPT_STAT( triangle_tests, 1 );
+							Real const d = mesh[ i ].intersect( ray );
+							if ( d > 0.0 && d < distance )
+							{
+								distance = d;
+								object_id = i;
+								f_hit = true;
+							}
+						}
+					}
+					else
+					{
+						// Visit near child first, push far child
+						if ( f_negative[ n.axis ] )
+						{
+							stack[ n_stack++ ] = current + 1;
+							current = n.offset;
+						}
+						else
+						{
+							stack[ n_stack++ ] = n.offset;
+							current = current + 1;
+						}
+						continue;
+					}
+				}
+				if ( n_stack == 0 )
+					break;
+				current = stack[ --n_stack ];
+			}
+
+			return { f_hit, distance, object_id };
+		};
+
+		// Any hit closer than distance, stops at the first one found
+		bool occluded(
+			Geometry::Mesh const& mesh,
+			Ray::Section const& ray,
+			Real const& distance
+		) const
+		{
+			if ( node.empty() )
+				return false;
+
+			Real3 const inv_direction( 1.0 / ray.direction.x, 1.0 / ray.direction.y, 1.0 / ray.direction.z );
+
+			std::array<uint32_t, max_stack> stack;
+			uint8_t n_stack{ 0 };
+			uint32_t current{ 0 };
+			while ( 1 )
+			{
+				Node const& n = node[ current ];
+				if ( n.bound.intersect( ray.origin, inv_direction, distance ) >= 0. )
+				{
+					if ( n.count > 0 )
+					{
+						for ( uint32_t i = n.offset; i < n.offset + n.count; ++i )
+						{
+							BPT_STAT( triangle_tests, 1 );
+							Real const d = mesh[ i ].intersect( ray );
+							if ( d > 0.0 && d < distance )
+								return true;
+						}
+					}
+					else
+					{
+						stack[ n_stack++ ] = n.offset;
+						current = current + 1;
+						continue;
+					}
+				}
+				if ( n_stack == 0 )
+					break;
+				current = stack[ --n_stack ];
+			}
+
+			return false;
+		};
+
+		std::vector<Node> const& nodes() const { return node; };
+
+		// Index in the mesh at build time, for each primitive in leaf order, see Geometry::Mesh::reorder
+		std::vector<uint32_t> const& primitive_ids() const { return primitive_id; };
+
+	private:
+
+		// Recursively build the subtree for reference[ first, last [ at depth, returns index of its root node
+		uint32_t build(
+			std::vector<Reference>& reference,
+			uint32_t const first,
+			uint32_t const last,
+			uint8_t const depth
+		)
+		{
+			uint32_t const node_id = static_cast<uint32_t>( node.size() );
+			node.emplace_back();
+
+			AABB bound;
+			AABB centre_bound;
+			for ( uint32_t i = first; i < last; ++i )
+			{
+				bound = bound + reference[ i ].bound;
+				centre_bound = centre_bound + reference[ i ].centre;
+			}
+			node[ node_id ].bound = bound;
+
+			uint32_t const count = last - first;
+			uint8_t const axis = centre_bound.longest_axis();
+			double const axis_min = centre_bound.minimum[ axis ];
+			double const axis_extent = centre_bound.extent()[ axis ];
+
+			// All centres coincide, or too few to split, or deep enough that SAH may be peeling off one primitive per level
+			if ( ( count == 1 ) || ( axis_extent <= 0. ) || ( depth >= Accelerator::max_sah_depth ) )
+			{
+				if ( count <= max_leaf )
+					return make_leaf( node_id, first, count );
+				// Fall back to a median split, which keeps the rest of the subtree balanced
+				return make_inner( reference, node_id, first, last, first + count / 2, axis, depth, true );
+			}
+
+			// Bin references along the longest axis
+			std::array<AABB, n_bin> bin_bound;
+			std::array<uint32_t, n_bin> bin_count{};
+			double const bin_scale = static_cast<double>( n_bin ) / axis_extent;
+			auto bin_index = [ & ]( Reference const& r ) -> uint8_t
+				{
+					return static_cast<uint8_t>( std::min<double>( ( r.centre[ axis ] - axis_min ) * bin_scale, n_bin - 1 ) );
+				};
+			for ( uint32_t i = first; i < last; ++i )
+			{
+				uint8_t const b = bin_index( reference[ i ] );
+				bin_bound[ b ] = bin_bound[ b ] + reference[ i ].bound;
+				++bin_count[ b ];
+			}
+
+			// Sweep from the right, then from the left, to evaluate every split plane between bins
+			std::array<double, n_bin - 1> right_cost;
+			AABB accumulate_bound;
+			uint32_t accumulate_count{ 0 };
+			for ( uint8_t b = n_bin - 1; b > 0; --b )
+			{
+				accumulate_bound = accumulate_bound + bin_bound[ b ];
+				accumulate_count += bin_count[ b ];
+				right_cost[ b - 1 ] = accumulate_count ? accumulate_bound.area() * accumulate_count : 0.;
+			}
+
+			double best_cost = DBL_MAX;
+			uint8_t best_split{ 0 };
+			accumulate_bound = AABB();
+			accumulate_count = 0;
+			for ( uint8_t b = 0; b < n_bin - 1; ++b )
+			{
+				accumulate_bound = accumulate_bound + bin_bound[ b ];
+				accumulate_count += bin_count[ b ];
+				double const cost = ( accumulate_count ? accumulate_bound.area() * accumulate_count : 0. ) + right_cost[ b ];
+				if ( cost < best_cost )
+				{
+					best_cost = cost;
+					best_split = b;
+				}
+			}
+
+			double const parent_area = bound.area();
+			best_cost = traversal_cost + ( parent_area > 0. ? best_cost / parent_area : count );
+			if ( ( count <= max_leaf ) && ( best_cost >= static_cast<double>( count ) ) )
+				return make_leaf( node_id, first, count );
+
+			Reference* middle = std::partition( &reference[ first ], &reference[ 0 ] + last,
+				[ & ]( Reference const& r ) { return bin_index( r ) <= best_split; } );
+			uint32_t const split = static_cast<uint32_t>( middle - &reference[ 0 ] );
+			if ( ( split == first ) || ( split == last ) )
+				return make_inner( reference, node_id, first, last, first + count / 2, axis, depth, true );
+
+			return make_inner( reference, node_id, first, last, split, axis, depth, false );
+		};
+
+		uint32_t make_leaf(
+			uint32_t const node_id,
+			uint32_t const first,
+			uint32_t const count
+		)
+		{
+			node[ node_id ].offset = first;
+			node[ node_id ].count = static_cast<uint16_t>( count );
+			return node_id;
+		};
+
+		uint32_t make_inner(
+			std::vector<Reference>& reference,
+			uint32_t const node_id,
+			uint32_t const first,
+			uint32_t const last,
+			uint32_t const split,
+			uint8_t const axis,
+			uint8_t const depth,
+			bool const f_median
+		)
+		{
+			// Median split needs the references ordered along the axis
+			if ( f_median )
+				std::nth_element( &reference[ first ], &reference[ split ], &reference[ 0 ] + last,
+					[ axis ]( Reference const& a, Reference const& b ) { return a.centre[ axis ] < b.centre[ axis ]; } );
+
+			build( reference, first, split, depth + 1 );
+			uint32_t const second = build( reference, split, last, depth + 1 );
+			node[ node_id ].offset = second;
+			node[ node_id ].count = 0;
+			node[ node_id ].axis = axis;
+			return node_id;
+		};
+
+	}; // end bvh class
+
+};
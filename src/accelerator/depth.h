@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Accelerator
+{
+
+	// Below this depth the builder splits by median instead of SAH, which may cut off one primitive per level
+	constexpr uint8_t max_sah_depth{ 64 };
+
+	// Deepest node of any tree, median splits of at most 2^32 primitives add up to 32 levels.
+	// Traversal stacks are sized by it, the wide tree is collapsed from the binary one so it is not deeper.
+	constexpr uint8_t max_depth{ max_sah_depth + 32 };
+
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "../accelerator/bvh.h"
+#include "../accelerator/wide_node.h"
+#include "../dispatch/isa.h"
+#include "../dispatch/kernel.h"
+#include "../geometry/mesh.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/vec3.h"
+#include "../memory/aligned_allocator.h"
+#include "../ray/section.h"
+#include "../ray/segment.h"
+
+namespace Accelerator
+{
+
+	// Wide bounding volume hierarchy, collapsed from a binary SAH tree.
+	// Child boxes of a node, and triangles of a leaf, are tested wide_width at a time.
+	// Traversal runs in the kernel variant of the instruction set chosen at startup.
+	class WideBVH final
+	{
+
+	public:
+
+		using Node = Accelerator::WideNode;
+		using Packet = Accelerator::TrianglePacket;
+
+		static constexpr uint8_t width{ Accelerator::wide_width };
+
+	private:
+
+		std::vector<Node, Memory::AlignedAllocator<Node>> node;
+		std::vector<Packet, Memory::AlignedAllocator<Packet>> packet;
+
+		// Instruction set variant of the traversal kernels
+		Dispatch::ISA isa{ Dispatch::ISA::SSE2 };
+
+	public:
+
+		WideBVH() {};
+
+		WideBVH(
+			Accelerator::BVH const& bvh,
+			Geometry::Mesh const& mesh,
+			Dispatch::ISA const& isa
+		)
+			: isa( isa )
+		{
+			std::vector<BVH::Node> const& binary = bvh.nodes();
+			if ( binary.empty() )
+				return;
+
+			node.reserve( binary.size() / 2 + 1 );
+			packet.reserve( mesh.size() / 2 + 1 );
+			// The mesh must be reordered by bvh.primitive_ids already
+			// The root is handled as a single child of a virtual parent, so a leaf root works too
+			collapse( bvh, mesh, { 0 } );
+		};
+
+		// Nodes and packets of a tree built before, e.g. read from a scene cache
+		WideBVH(
+			std::span<Node const> const& node_data,
+			std::span<Packet const> const& packet_data,
+			Dispatch::ISA const& isa
+		)
+			: node( node_data.begin(), node_data.end() ), packet( packet_data.begin(), packet_data.end() ), isa( isa )
+		{};
+
+		// Closest hit, distance and index of the triangle in the mesh
+		std::tuple<bool, Real, uint32_t> intersect(
+			Ray::Section const& ray,
+			Real const& distance
+		) const
+		{
+			if ( node.empty() )
+				return { false, distance, 0 };
+
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return Kernel::AVX512::intersect( node.data(), packet.data(), ray, distance );
+			case Dispatch::ISA::AVX2:
+				return Kernel::AVX2::intersect( node.data(), packet.data(), ray, distance );
+			default:
+				return Kernel::SSE2::intersect( node.data(), packet.data(), ray, distance );
+			}
+		};
+
+		// Packet of rays from a shared origin, at most 64, closest hits
+		// distance holds the maximum distance of each ray on entry, and the hit distance on return
+		// Bit i of the result is set when ray i hit, the index of its triangle is in object_id[ i ]
+		uint64_t intersect(
+			Real3 const& origin,
+			Real3 const* direction,
+			uint8_t const& count,
+			Real* distance,
+			uint32_t* object_id
+		) const
+		{
+			if ( node.empty() || ( count == 0 ) )
+				return 0;
+
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return Kernel::AVX512::intersect( node.data(), packet.data(), origin, direction, count, distance, object_id );
+			case Dispatch::ISA::AVX2:
+				return Kernel::AVX2::intersect( node.data(), packet.data(), origin, direction, count, distance, object_id );
+			default:
+				return Kernel::SSE2::intersect( node.data(), packet.data(), origin, direction, count, distance, object_id );
+			}
+		};
+
+		// Any hit closer than distance, stops at the first one found
+		bool occluded(
+			Ray::Section const& ray,
+			Real const& distance
+		) const
+		{
+			if ( node.empty() )
+				return false;
+
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return Kernel::AVX512::occluded( node.data(), packet.data(), ray, distance );
+			case Dispatch::ISA::AVX2:
+				return Kernel::AVX2::occluded( node.data(), packet.data(), ray, distance );
+			default:
+				return Kernel::SSE2::occluded( node.data(), packet.data(), ray, distance );
+			}
+		};
+
+		// Batch of shadow rays from a shared origin, at most 64
+		// Bit i of the result is set when segment i is occluded
+		uint64_t occluded(
+			Real3 const& origin,
+			Ray::Segment const* segment,
+			uint8_t const& count
+		) const
+		{
+			if ( node.empty() || ( count == 0 ) )
+				return 0;
+
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return Kernel::AVX512::occluded( node.data(), packet.data(), origin, segment, count );
+			case Dispatch::ISA::AVX2:
+				return Kernel::AVX2::occluded( node.data(), packet.data(), origin, segment, count );
+			default:
+				return Kernel::SSE2::occluded( node.data(), packet.data(), origin, segment, count );
+			}
+		};
+
+		std::span<Node const> nodes() const { return node; };
+		std::span<Packet const> packets() const { return packet; };
+
+	private:
+
+		// Create a wide node from up to width binary subtrees, returns its index
+		uint32_t collapse(
+			Accelerator::BVH const& bvh,
+			Geometry::Mesh const& mesh,
+			std::vector<uint32_t> children
+		)
+		{
+			std::vector<BVH::Node> const& binary = bvh.nodes();
+
+			// Open the inner child with the largest surface area, until the node is full
+			while ( children.size() < width )
+			{
+				int32_t largest{ -1 };
+				double largest_area{ -1. };
+				for ( uint32_t i = 0; i < children.size(); ++i )
+				{
+					BVH::Node const& c = binary[ children[ i ] ];
+					if ( ( c.count == 0 ) && ( c.bound.area() > largest_area ) )
+					{
+						largest = i;
+						largest_area = c.bound.area();
+					}
+				}
+				if ( largest < 0 )
+					break;
+				uint32_t const opened = children[ largest ];
+				children[ largest ] = opened + 1;
+				children.push_back( binary[ opened ].offset );
+			}
+
+			uint32_t const node_id = static_cast<uint32_t>( node.size() );
+			node.emplace_back();
+			for ( uint8_t lane = 0; lane < width; ++lane )
+			{
+				// Empty lanes get an inverted box, they are masked by valid anyway
+				node[ node_id ].min_x[ lane ] = node[ node_id ].min_y[ lane ] = node[ node_id ].min_z[ lane ] = std::numeric_limits<Real>::max();
+				node[ node_id ].max_x[ lane ] = node[ node_id ].max_y[ lane ] = node[ node_id ].max_z[ lane ] = -std::numeric_limits<Real>::max();
+				node[ node_id ].child[ lane ] = 0;
+				node[ node_id ].count[ lane ] = 0;
+			}
+
+			for ( uint8_t lane = 0; lane < children.size(); ++lane )
+			{
+				BVH::Node const& c = binary[ children[ lane ] ];
+				uint32_t child{ 0 };
+				uint16_t count{ 0 };
+				if ( c.count > 0 )
+					std::tie( child, count ) = make_packets( mesh, c );
+				else
+					child = collapse( bvh, mesh, { children[ lane ] + 1, c.offset } );
+
+				// Vector may have grown during recursion, so index again
+				Node& n = node[ node_id ];
+				n.min_x[ lane ] = c.bound.minimum.x;
+				n.min_y[ lane ] = c.bound.minimum.y;
+				n.min_z[ lane ] = c.bound.minimum.z;
+				n.max_x[ lane ] = c.bound.maximum.x;
+				n.max_y[ lane ] = c.bound.maximum.y;
+				n.max_z[ lane ] = c.bound.maximum.z;
+				n.child[ lane ] = child;
+				n.count[ lane ] = count;
+				n.valid |= 1 << lane;
+			}
+
+			return node_id;
+		};
+
+		// Pack the triangles of a binary leaf, returns first packet index and packet count
+		// The mesh is already in leaf order
+		std::tuple<uint32_t, uint16_t> make_packets(
+			Geometry::Mesh const& mesh,
+			BVH::Node const& leaf
+		)
+		{
+			uint32_t const first = static_cast<uint32_t>( packet.size() );
+			for ( uint32_t i = 0; i < leaf.count; ++i )
+			{
+				uint8_t const lane = i % width;
+				if ( lane == 0 )
+				{
+					packet.push_back( Packet{} );
+					std::fill_n( packet.back().id, width, Accelerator::unused_id );
+				}
+				Packet& p = packet.back();
+
+				uint32_t const id = leaf.offset + i;
+				Geometry::Triangle const& t = mesh[ id ];
+				p.position_x[ lane ] = t.position.x;
+				p.position_y[ lane ] = t.position.y;
+				p.position_z[ lane ] = t.position.z;
+				p.edge1_x[ lane ] = t.edge1.x;
+				p.edge1_y[ lane ] = t.edge1.y;
+				p.edge1_z[ lane ] = t.edge1.z;
+				p.edge2_x[ lane ] = t.edge2.x;
+				p.edge2_y[ lane ] = t.edge2.y;
+				p.edge2_z[ lane ] = t.edge2.z;
+				p.id[ lane ] = id;
+			}
+			return { first, static_cast<uint16_t>( packet.size() - first ) };
+		};
+
+	}; // end wide bvh class
+
+};
@@ -0,0 +1,567 @@
+// Wide BVH traversal kernels.
+// No include guard, dispatch/kernel.h includes this once per instruction set,
+// each time inside its own namespace and target options.
+
+// One lane per child of a node, or per triangle of a packet, in the precision of Real
+#if defined( BPT_SINGLE_PRECISION )
+#include "../mathematics/float8.h"
+using Lanes = Float8;
+#else
+#include "../mathematics/double4.h"
+using Lanes = Double4;
+#endif
+
+// Slab test of all children, returns lane mask of hit children and their entry distances
+inline uint8_t intersect_children(
+	Accelerator::WideNode const& n,
+	Lanes const& origin_x,
+	Lanes const& origin_y,
+	Lanes const& origin_z,
+	Lanes const& inv_x,
+	Lanes const& inv_y,
+	Lanes const& inv_z,
+	Real const& distance,
+	Real* t_lane
+)
+{
+	Lanes const tx0 = ( Lanes::load( n.min_x ) - origin_x ) * inv_x;
+	Lanes const tx1 = ( Lanes::load( n.max_x ) - origin_x ) * inv_x;
+	Lanes const ty0 = ( Lanes::load( n.min_y ) - origin_y ) * inv_y;
+	Lanes const ty1 = ( Lanes::load( n.max_y ) - origin_y ) * inv_y;
+	Lanes const tz0 = ( Lanes::load( n.min_z ) - origin_z ) * inv_z;
+	Lanes const tz1 = ( Lanes::load( n.max_z ) - origin_z ) * inv_z;
+
+	Lanes const t_near = Lanes::max( Lanes::max( Lanes::min( tx0, tx1 ), Lanes::min( ty0, ty1 ) ), Lanes::max( Lanes::min( tz0, tz1 ), Lanes( 0. ) ) );
+	Lanes const t_far = Lanes::min( Lanes::min( Lanes::max( tx0, tx1 ), Lanes::max( ty0, ty1 ) ), Lanes::min( Lanes::max( tz0, tz1 ), Lanes( distance ) ) );
+
+	t_near.store( t_lane );
+	return ( t_near <= t_far ).mask() & n.valid;
+};
+
+// Moller-Trumbore for a packet of triangles, same tests and tolerances as Geometry::Triangle
+// Returns lane mask of triangles hit closer than distance
+inline uint8_t intersect_packet(
+	Accelerator::TrianglePacket const& p,
+	Lanes const& origin_x,
+	Lanes const& origin_y,
+	Lanes const& origin_z,
+	Lanes const& direction_x,
+	Lanes const& direction_y,
+	Lanes const& direction_z,
+	Real const& distance,
+	Real* t_triangle
+)
+{
+	BPT_STAT( triangle_tests, p.lanes() );
+	Lanes const e1_x = Lanes::load( p.edge1_x ), e1_y = Lanes::load( p.edge1_y ), e1_z = Lanes::load( p.edge1_z );
+	Lanes const e2_x = Lanes::load( p.edge2_x ), e2_y = Lanes::load( p.edge2_y ), e2_z = Lanes::load( p.edge2_z );
+
+	// p = direction cross edge2
+	Lanes const p_x = direction_y * e2_z - direction_z * e2_y;
+	Lanes const p_y = direction_z * e2_x - direction_x * e2_z;
+	Lanes const p_z = direction_x * e2_y - direction_y * e2_x;
+	Lanes const d = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+	Lanes mask = d.abs() >= Lanes( 0.000001 );
+	if ( !mask.mask() )
+		return 0;
+
+	Lanes const inv_d = Lanes( 1.0 ) / d;
+
+	Lanes const diff_x = origin_x - Lanes::load( p.position_x );
+	Lanes const diff_y = origin_y - Lanes::load( p.position_y );
+	Lanes const diff_z = origin_z - Lanes::load( p.position_z );
+
+	Lanes const u = ( diff_x * p_x + diff_y * p_y + diff_z * p_z ) * inv_d;
+	mask = mask & ( u >= Lanes( 0. ) ) & ( u <= Lanes( 1. ) );
+
+	// q = diff cross edge1
+	Lanes const q_x = diff_y * e1_z - diff_z * e1_y;
+	Lanes const q_y = diff_z * e1_x - diff_x * e1_z;
+	Lanes const q_z = diff_x * e1_y - diff_y * e1_x;
+	Lanes const v = ( direction_x * q_x + direction_y * q_y + direction_z * q_z ) * inv_d;
+	mask = mask & ( v >= Lanes( 0. ) ) & ( ( u + v ) <= Lanes( 1. ) );
+
+	Lanes const t = ( q_x * e2_x + q_y * e2_y + q_z * e2_z ) * inv_d;
+	mask = mask & ( t >= Lanes( 0.000001 ) ) & ( t < Lanes( distance ) );
+
+	t.store( t_triangle );
+	return mask.mask();
+};
+
+// Closest hit, distance and index of the primitive
+inline std::tuple<bool, Real, uint32_t> intersect(
+	Accelerator::WideNode const* node,
+	Accelerator::TrianglePacket const* packet,
+	Ray::Section const& ray,
+	Real distance
+)
+{
+	constexpr uint8_t width{ Accelerator::wide_width };
+	// A node pushes at most all of its children, and leaves siblings on the stack at each of at most max_depth levels above
+	constexpr uint16_t max_stack{ Accelerator::max_depth * ( width - 1 ) + 1 };
+
+	bool f_hit{ false };
+	uint32_t object_id{ 0 };
+
+	Lanes const origin_x( ray.origin.x ), origin_y( ray.origin.y ), origin_z( ray.origin.z );
+	Lanes const direction_x( ray.direction.x ), direction_y( ray.direction.y ), direction_z( ray.direction.z );
+	Lanes const inv_x( 1.0 / ray.direction.x ), inv_y( 1.0 / ray.direction.y ), inv_z( 1.0 / ray.direction.z );
+
+	// Node index, and entry distance of the node box
+	std::array<uint32_t, max_stack> stack;
+	std::array<Real, max_stack> stack_distance;
+	uint16_t n_stack{ 0 };
+	stack[ n_stack ] = 0;
+	stack_distance[ n_stack++ ] = 0.;
+
+	alignas( 32 ) Real t_lane[ width ];
+	alignas( 32 ) Real t_triangle[ width ];
+	while ( n_stack > 0 )
+	{
+		--n_stack;
+		if ( stack_distance[ n_stack ] >= distance )
+			continue;
+		Accelerator::WideNode const& n = node[ stack[ n_stack ] ];
+
+		uint8_t const hit_mask = intersect_children( n, origin_x, origin_y, origin_z, inv_x, inv_y, inv_z, distance, t_lane );
+		if ( !hit_mask )
+			continue;
+
+		// Leaves first, as they may shorten the ray before inner children are pushed
+		uint8_t inner_mask{ 0 };
+		for ( uint8_t lanes = hit_mask; lanes; lanes &= lanes - 1 )
+		{
+			uint8_t const lane = static_cast<uint8_t>( std::countr_zero( lanes ) );
+			if ( n.count[ lane ] == 0 )
+			{
+				inner_mask |= 1 << lane;
+				continue;
+			}
+			for ( uint32_t p = n.child[ lane ]; p < n.child[ lane ] + n.count[ lane ]; ++p )
+			{
+				uint8_t const triangle_mask = intersect_packet( packet[ p ], origin_x, origin_y, origin_z, direction_x, direction_y, direction_z, distance, t_triangle );
+				for ( uint8_t bits = triangle_mask; bits; bits &= bits - 1 )
+				{
+					uint8_t const i = static_cast<uint8_t>( std::countr_zero( bits ) );
+					if ( t_triangle[ i ] < distance )
+					{
+						distance = t_triangle[ i ];
+						object_id = packet[ p ].id[ i ];
+						f_hit = true;
+					}
+				}
+			}
+		}
+
+		// Push inner children far to near, so the nearest is popped first.
+		// Sorted by insertion, as there are at most width of them.
+		uint8_t order[ width ];
+		uint8_t n_order{ 0 };
+		for ( uint8_t lanes = inner_mask; lanes; lanes &= lanes - 1 )
+		{
+			uint8_t const lane = static_cast<uint8_t>( std::countr_zero( lanes ) );
+			if ( t_lane[ lane ] >= distance )
+				continue;
+			uint8_t i = n_order++;
+			for ( ; ( i > 0 ) && ( t_lane[ order[ i - 1 ] ] < t_lane[ lane ] ); --i )
+				order[ i ] = order[ i - 1 ];
+			order[ i ] = lane;
+		}
+		for ( uint8_t i = 0; i < n_order; ++i )
+		{
+			stack[ n_stack ] = n.child[ order[ i ] ];
+			stack_distance[ n_stack++ ] = t_lane[ order[ i ] ];
+		}
+	}
+
+	return { f_hit, distance, object_id };
+};
+
+// Any hit closer than distance in the subtree of node root, stops at the first one found
+FORCE_INLINE bool occluded_subtree(
+	Accelerator::WideNode const* node,
+	Accelerator::TrianglePacket const* packet,
+	uint32_t const root,
+	Ray::Section const& ray,
+	Real const& distance
+)
+{
+	constexpr uint8_t width{ Accelerator::wide_width };
+	constexpr uint16_t max_stack{ Accelerator::max_depth * ( width - 1 ) + 1 };
+
+	Lanes const origin_x( ray.origin.x ), origin_y( ray.origin.y ), origin_z( ray.origin.z );
+	Lanes const direction_x( ray.direction.x ), direction_y( ray.direction.y ), direction_z( ray.direction.z );
+	Lanes const inv_x( 1.0 / ray.direction.x ), inv_y( 1.0 / ray.direction.y ), inv_z( 1.0 / ray.direction.z );
+
+	std::array<uint32_t, max_stack> stack;
+	uint16_t n_stack{ 0 };
+	stack[ n_stack++ ] = root;
+
+	alignas( 32 ) Real t_lane[ width ];
+	alignas( 32 ) Real t_triangle[ width ];
+	while ( n_stack > 0 )
+	{
+		Accelerator::WideNode const& n = node[ stack[ --n_stack ] ];
+
+		uint8_t const hit_mask = intersect_children( n, origin_x, origin_y, origin_z, inv_x, inv_y, inv_z, distance, t_lane );
+		for ( uint8_t lanes = hit_mask; lanes; lanes &= lanes - 1 )
+		{
+			uint8_t const lane = static_cast<uint8_t>( std::countr_zero( lanes ) );
+			if ( n.count[ lane ] == 0 )
+			{
+				stack[ n_stack++ ] = n.child[ lane ];
+				continue;
+			}
+			for ( uint32_t p = n.child[ lane ]; p < n.child[ lane ] + n.count[ lane ]; ++p )
+				if ( intersect_packet( packet[ p ], origin_x, origin_y, origin_z, direction_x, direction_y, direction_z, distance, t_triangle ) )
+					return true;
+		}
+	}
+
+	return false;
+};
+
+// Any hit closer than distance, stops at the first one found
+inline bool occluded(
+	Accelerator::WideNode const* node,
+	Accelerator::TrianglePacket const* packet,
+	Ray::Section const& ray,
+	Real const& distance
+)
+{
+	return occluded_subtree( node, packet, 0, ray, distance );
+};
+
+// Batch of shadow rays from a shared origin, at most 64
+// Bit i of the result is set when segment i is occluded
+inline uint64_t occluded(
+	Accelerator::WideNode const* node,
+	Accelerator::TrianglePacket const* packet,
+	Real3 const& origin,
+	Ray::Segment const* segment,
+	uint8_t const count
+)
+{
+	constexpr uint8_t width{ Accelerator::wide_width };
+	constexpr uint16_t max_stack{ Accelerator::max_depth * ( width - 1 ) + 1 };
+	constexpr uint8_t max_count{ 64 };
+	// Subtrees entered by this few rays are traversed per ray, as the shared box loads no longer pay for the bookkeeping
+	constexpr int sparse_count{ 4 };
+
+	uint64_t const all = ( count >= max_count ) ? ~0ull : ( 1ull << count ) - 1;
+	uint64_t result{ 0 };
+
+	Lanes const origin_x( origin.x ), origin_y( origin.y ), origin_z( origin.z );
+
+	// Per ray data, computed once for the whole traversal
+	Real inv_x[ max_count ], inv_y[ max_count ], inv_z[ max_count ];
+	for ( uint8_t r = 0; r < count; ++r )
+	{
+		inv_x[ r ] = 1.0 / segment[ r ].direction.x;
+		inv_y[ r ] = 1.0 / segment[ r ].direction.y;
+		inv_z[ r ] = 1.0 / segment[ r ].direction.z;
+	}
+
+	// Node index, and the rays that entered it
+	std::array<uint32_t, max_stack> stack;
+	std::array<uint64_t, max_stack> stack_ray;
+	uint16_t n_stack{ 0 };
+	stack[ n_stack ] = 0;
+	stack_ray[ n_stack++ ] = all;
+
+	while ( n_stack > 0 )
+	{
+		--n_stack;
+		// Rays found occluded meanwhile need no further work
+		uint64_t const active = stack_ray[ n_stack ] & ~result;
+		if ( !active )
+			continue;
+		if ( std::popcount( active ) <= sparse_count )
+		{
+			for ( uint64_t bits = active; bits; bits &= bits - 1 )
+			{
+				uint8_t const r = static_cast<uint8_t>( std::countr_zero( bits ) );
+				if ( occluded_subtree( node, packet, stack[ n_stack ], Ray::Section( origin, segment[ r ].direction ), segment[ r ].distance ) )
+					result |= 1ull << r;
+			}
+			continue;
+		}
+		Accelerator::WideNode const& n = node[ stack[ n_stack ] ];
+
+		// Box planes relative to the shared origin
+		Lanes const min_x = Lanes::load( n.min_x ) - origin_x;
+		Lanes const max_x = Lanes::load( n.max_x ) - origin_x;
+		Lanes const min_y = Lanes::load( n.min_y ) - origin_y;
+		Lanes const max_y = Lanes::load( n.max_y ) - origin_y;
+		Lanes const min_z = Lanes::load( n.min_z ) - origin_z;
+		Lanes const max_z = Lanes::load( n.max_z ) - origin_z;
+
+		uint64_t child_ray[ width ] = { 0 };
+		for ( uint64_t bits = active; bits; bits &= bits - 1 )
+		{
+			uint8_t const r = static_cast<uint8_t>( std::countr_zero( bits ) );
+			Lanes const ix( inv_x[ r ] ), iy( inv_y[ r ] ), iz( inv_z[ r ] );
+			Lanes const tx0 = min_x * ix, tx1 = max_x * ix;
+			Lanes const ty0 = min_y * iy, ty1 = max_y * iy;
+			Lanes const tz0 = min_z * iz, tz1 = max_z * iz;
+			Lanes const t_near = Lanes::max( Lanes::max( Lanes::min( tx0, tx1 ), Lanes::min( ty0, ty1 ) ), Lanes::max( Lanes::min( tz0, tz1 ), Lanes( 0. ) ) );
+			Lanes const t_far = Lanes::min( Lanes::min( Lanes::max( tx0, tx1 ), Lanes::max( ty0, ty1 ) ), Lanes::min( Lanes::max( tz0, tz1 ), Lanes( segment[ r ].distance ) ) );
+			uint8_t const hit_mask = ( t_near <= t_far ).mask() & n.valid;
+			for ( uint8_t lanes = hit_mask; lanes; lanes &= lanes - 1 )
+				child_ray[ std::countr_zero( lanes ) ] |= 1ull << r;
+		}
+
+		for ( uint8_t lane = 0; lane < width; ++lane )
+		{
+			if ( !child_ray[ lane ] )
+				continue;
+			if ( n.count[ lane ] == 0 )
+			{
+				stack[ n_stack ] = n.child[ lane ];
+				stack_ray[ n_stack++ ] = child_ray[ lane ];
+				continue;
+			}
+			for ( uint32_t p = n.child[ lane ]; p < n.child[ lane ] + n.count[ lane ]; ++p )
+			{
+				Accelerator::TrianglePacket const& t = packet[ p ];
+				Lanes const e1_x = Lanes::load( t.edge1_x ), e1_y = Lanes::load( t.edge1_y ), e1_z = Lanes::load( t.edge1_z );
+				Lanes const e2_x = Lanes::load( t.edge2_x ), e2_y = Lanes::load( t.edge2_y ), e2_z = Lanes::load( t.edge2_z );
+
+				// Moller-Trumbore terms that only depend on the origin are shared by all rays
+				Lanes const diff_x = origin_x - Lanes::load( t.position_x );
+				Lanes const diff_y = origin_y - Lanes::load( t.position_y );
+				Lanes const diff_z = origin_z - Lanes::load( t.position_z );
+				Lanes const q_x = diff_y * e1_z - diff_z * e1_y;
+				Lanes const q_y = diff_z * e1_x - diff_x * e1_z;
+				Lanes const q_z = diff_x * e1_y - diff_y * e1_x;
+				Lanes const t_numerator = q_x * e2_x + q_y * e2_y + q_z * e2_z;
+
+				for ( uint64_t bits = child_ray[ lane ] & ~result; bits; bits &= bits - 1 )
+				{
+					uint8_t const r = static_cast<uint8_t>( std::countr_zero( bits ) );
+					BPT_STAT( triangle_tests, t.lanes() );
+					Lanes const direction_x( segment[ r ].direction.x ), direction_y( segment[ r ].direction.y ), direction_z( segment[ r ].direction.z );
+
+					Lanes const p_x = direction_y * e2_z - direction_z * e2_y;
+					Lanes const p_y = direction_z * e2_x - direction_x * e2_z;
+					Lanes const p_z = direction_x * e2_y - direction_y * e2_x;
+					Lanes const d = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+					Lanes mask = d.abs() >= Lanes( 0.000001 );
+					if ( !mask.mask() )
+						continue;
+
+					Lanes const inv_d = Lanes( 1.0 ) / d;
+					Lanes const u = ( diff_x * p_x + diff_y * p_y + diff_z * p_z ) * inv_d;
+					Lanes const v = ( direction_x * q_x + direction_y * q_y + direction_z * q_z ) * inv_d;
+					Lanes const t_hit = t_numerator * inv_d;
+					mask = mask & ( u >= Lanes( 0. ) ) & ( u <= Lanes( 1. ) ) & ( v >= Lanes( 0. ) ) & ( ( u + v ) <= Lanes( 1. ) );
+					mask = mask & ( t_hit >= Lanes( 0.000001 ) ) & ( t_hit < Lanes( segment[ r ].distance ) );
+					if ( mask.mask() )
+						result |= 1ull << r;
+				}
+			}
+		}
+
+		if ( result == all )
+			break;
+	}
+
+	return result;
+};
+
+// Packet of rays from a shared origin, at most 64, e.g. primary rays of a pinhole camera
+// distance holds the maximum distance of each ray on entry, and the closest hit distance on return
+// Bit i of the result is set when ray i hit, the index of its primitive is in object_id[ i ]
+inline uint64_t intersect(
+	Accelerator::WideNode const* node,
+	Accelerator::TrianglePacket const* packet,
+	Real3 const& origin,
+	Real3 const* direction,
+	uint8_t const count,
+	Real* distance,
+	uint32_t* object_id
+)
+{
+	constexpr uint8_t width{ Accelerator::wide_width };
+	constexpr uint16_t max_stack{ Accelerator::max_depth * ( width - 1 ) + 1 };
+	constexpr uint8_t max_count{ 64 };
+
+	uint64_t const all = ( count >= max_count ) ? ~0ull : ( 1ull << count ) - 1;
+	uint64_t result{ 0 };
+
+	Lanes const origin_x( origin.x ), origin_y( origin.y ), origin_z( origin.z );
+
+	// Per ray data, computed once for the whole traversal
+	Real inv_x[ max_count ], inv_y[ max_count ], inv_z[ max_count ];
+	for ( uint8_t r = 0; r < count; ++r )
+	{
+		inv_x[ r ] = 1.0 / direction[ r ].x;
+		inv_y[ r ] = 1.0 / direction[ r ].y;
+		inv_z[ r ] = 1.0 / direction[ r ].z;
+	}
+
+	// Frustum of the packet, as bounds of the inverse direction on each axis.
+	// Only usable if no direction component changes sign within the packet, then the bounds are finite.
+	auto const inv_bound = [ & ]( Real const* inv )
+		{
+			auto const [lo, hi] = std::minmax_element( inv, inv + count );
+			bool const f_valid = std::isfinite( *lo ) && std::isfinite( *hi ) && ( ( *lo > 0. ) || ( *hi < 0. ) );
+			return std::tuple( f_valid, *lo, *hi );
+		};
+	auto const [f_frustum_x, inv_lo_x, inv_hi_x] = inv_bound( inv_x );
+	auto const [f_frustum_y, inv_lo_y, inv_hi_y] = inv_bound( inv_y );
+	auto const [f_frustum_z, inv_lo_z, inv_hi_z] = inv_bound( inv_z );
+	bool const f_frustum = f_frustum_x && f_frustum_y && f_frustum_z;
+	Lanes const frustum_lo_x( inv_lo_x ), frustum_lo_y( inv_lo_y ), frustum_lo_z( inv_lo_z );
+	Lanes const frustum_hi_x( inv_hi_x ), frustum_hi_y( inv_hi_y ), frustum_hi_z( inv_hi_z );
+
+	// Longest ray of the packet, shrinks as hits are found
+	auto const packet_distance = [ & ]() { return *std::max_element( distance, distance + count ); };
+	Real max_distance = packet_distance();
+
+	// Node index, and the rays that entered it
+	std::array<uint32_t, max_stack> stack;
+	std::array<uint64_t, max_stack> stack_ray;
+	uint16_t n_stack{ 0 };
+	stack[ n_stack ] = 0;
+	stack_ray[ n_stack++ ] = all;
+
+	alignas( 32 ) Real t_lane[ width ];
+	alignas( 32 ) Real t_triangle[ width ];
+	while ( n_stack > 0 )
+	{
+		--n_stack;
+		uint64_t const active = stack_ray[ n_stack ];
+		Accelerator::WideNode const& n = node[ stack[ n_stack ] ];
+
+		// Box planes relative to the shared origin
+		Lanes const min_x = Lanes::load( n.min_x ) - origin_x;
+		Lanes const max_x = Lanes::load( n.max_x ) - origin_x;
+		Lanes const min_y = Lanes::load( n.min_y ) - origin_y;
+		Lanes const max_y = Lanes::load( n.max_y ) - origin_y;
+		Lanes const min_z = Lanes::load( n.min_z ) - origin_z;
+		Lanes const max_z = Lanes::load( n.max_z ) - origin_z;
+
+		// Cull children the whole frustum misses, interval arithmetic over the inverse direction bounds
+		uint8_t frustum_mask = n.valid;
+		if ( f_frustum )
+		{
+			auto const slab = []( Lanes const& lo, Lanes const& hi, Lanes const& inv_lo, Lanes const& inv_hi )
+				{
+					Lanes const a = lo * inv_lo, b = lo * inv_hi, c = hi * inv_lo, d = hi * inv_hi;
+					return std::tuple( Lanes::min( Lanes::min( a, b ), Lanes::min( c, d ) ), Lanes::max( Lanes::max( a, b ), Lanes::max( c, d ) ) );
+				};
+			auto const [near_x, far_x] = slab( min_x, max_x, frustum_lo_x, frustum_hi_x );
+			auto const [near_y, far_y] = slab( min_y, max_y, frustum_lo_y, frustum_hi_y );
+			auto const [near_z, far_z] = slab( min_z, max_z, frustum_lo_z, frustum_hi_z );
+			Lanes const t_near = Lanes::max( Lanes::max( near_x, near_y ), Lanes::max( near_z, Lanes( 0. ) ) );
+			Lanes const t_far = Lanes::min( Lanes::min( far_x, far_y ), Lanes::min( far_z, Lanes( max_distance ) ) );
+			frustum_mask &= ( t_near <= t_far ).mask();
+			if ( !frustum_mask )
+				continue;
+		}
+
+		// Rays that enter each child, and the nearest entry of any ray for the traversal order
+		uint64_t child_ray[ width ] = { 0 };
+		Lanes lane_near( std::numeric_limits<Real>::max() );
+		for ( uint64_t bits = active; bits; bits &= bits - 1 )
+		{
+			uint8_t const r = static_cast<uint8_t>( std::countr_zero( bits ) );
+			Lanes const ix( inv_x[ r ] ), iy( inv_y[ r ] ), iz( inv_z[ r ] );
+			Lanes const tx0 = min_x * ix, tx1 = max_x * ix;
+			Lanes const ty0 = min_y * iy, ty1 = max_y * iy;
+			Lanes const tz0 = min_z * iz, tz1 = max_z * iz;
+			Lanes const t_near = Lanes::max( Lanes::max( Lanes::min( tx0, tx1 ), Lanes::min( ty0, ty1 ) ), Lanes::max( Lanes::min( tz0, tz1 ), Lanes( 0. ) ) );
+			Lanes const t_far = Lanes::min( Lanes::min( Lanes::max( tx0, tx1 ), Lanes::max( ty0, ty1 ) ), Lanes::min( Lanes::max( tz0, tz1 ), Lanes( distance[ r ] ) ) );
+			uint8_t const hit_mask = ( t_near <= t_far ).mask() & frustum_mask;
+			if ( !hit_mask )
+				continue;
+			lane_near = Lanes::min( lane_near, t_near );
+			for ( uint8_t lanes = hit_mask; lanes; lanes &= lanes - 1 )
+				child_ray[ std::countr_zero( lanes ) ] |= 1ull << r;
+		}
+		lane_near.store( t_lane );
+
+		// Leaves first, as they may shorten the rays before inner children are pushed
+		uint8_t inner_mask{ 0 };
+		for ( uint8_t lane = 0; lane < width; ++lane )
+		{
+			if ( !child_ray[ lane ] )
+				continue;
+			if ( n.count[ lane ] == 0 )
+			{
+				inner_mask |= 1 << lane;
+				continue;
+			}
+			for ( uint32_t p = n.child[ lane ]; p < n.child[ lane ] + n.count[ lane ]; ++p )
+			{
+				Accelerator::TrianglePacket const& t = packet[ p ];
+				Lanes const e1_x = Lanes::load( t.edge1_x ), e1_y = Lanes::load( t.edge1_y ), e1_z = Lanes::load( t.edge1_z );
+				Lanes const e2_x = Lanes::load( t.edge2_x ), e2_y = Lanes::load( t.edge2_y ), e2_z = Lanes::load( t.edge2_z );
+
+				// Moller-Trumbore terms that only depend on the origin are shared by all rays
+				Lanes const diff_x = origin_x - Lanes::load( t.position_x );
+				Lanes const diff_y = origin_y - Lanes::load( t.position_y );
+				Lanes const diff_z = origin_z - Lanes::load( t.position_z );
+				Lanes const q_x = diff_y * e1_z - diff_z * e1_y;
+				Lanes const q_y = diff_z * e1_x - diff_x * e1_z;
+				Lanes const q_z = diff_x * e1_y - diff_y * e1_x;
+				Lanes const t_numerator = q_x * e2_x + q_y * e2_y + q_z * e2_z;
+
+				for ( uint64_t bits = child_ray[ lane ]; bits; bits &= bits - 1 )
+				{
+					uint8_t const r = static_cast<uint8_t>( std::countr_zero( bits ) );
+					BPT_STAT( triangle_tests, t.lanes() );
+					Lanes const direction_x( direction[ r ].x ), direction_y( direction[ r ].y ), direction_z( direction[ r ].z );
+
+					Lanes const p_x = direction_y * e2_z - direction_z * e2_y;
+					Lanes const p_y = direction_z * e2_x - direction_x * e2_z;
+					Lanes const p_z = direction_x * e2_y - direction_y * e2_x;
+					Lanes const d = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+					Lanes mask = d.abs() >= Lanes( 0.000001 );
+					if ( !mask.mask() )
+						continue;
+
+					Lanes const inv_d = Lanes( 1.0 ) / d;
+					Lanes const u = ( diff_x * p_x + diff_y * p_y + diff_z * p_z ) * inv_d;
+					Lanes const v = ( direction_x * q_x + direction_y * q_y + direction_z * q_z ) * inv_d;
+					Lanes const t_hit = t_numerator * inv_d;
+					mask = mask & ( u >= Lanes( 0. ) ) & ( u <= Lanes( 1. ) ) & ( v >= Lanes( 0. ) ) & ( ( u + v ) <= Lanes( 1. ) );
+					mask = mask & ( t_hit >= Lanes( 0.000001 ) ) & ( t_hit < Lanes( distance[ r ] ) );
+					uint8_t const triangle_mask = mask.mask();
+					if ( !triangle_mask )
+						continue;
+
+					t_hit.store( t_triangle );
+					for ( uint8_t i = 0; i < width; ++i )
+						if ( ( triangle_mask & ( 1 << i ) ) && ( t_triangle[ i ] < distance[ r ] ) )
+						{
+							distance[ r ] = t_triangle[ i ];
+							object_id[ r ] = t.id[ i ];
+							result |= 1ull << r;
+						}
+				}
+			}
+			max_distance = packet_distance();
+		}
+
+		// Push inner children far to near, so the nearest is popped first, sorted by insertion as in the single ray kernel
+		uint8_t order[ width ];
+		uint8_t n_order{ 0 };
+		for ( uint8_t lanes = inner_mask; lanes; lanes &= lanes - 1 )
+		{
+			uint8_t const lane = static_cast<uint8_t>( std::countr_zero( lanes ) );
+			uint8_t i = n_order++;
+			for ( ; ( i > 0 ) && ( t_lane[ order[ i - 1 ] ] < t_lane[ lane ] ); --i )
+				order[ i ] = order[ i - 1 ];
+			order[ i ] = lane;
+		}
+		for ( uint8_t i = 0; i < n_order; ++i )
+		{
+			stack[ n_stack ] = n.child[ order[ i ] ];
+			stack_ray[ n_stack++ ] = child_ray[ order[ i ] ];
+		}
+	}
+
+	return result;
+};
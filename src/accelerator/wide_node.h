@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../mathematics/real.h"
+
+namespace Accelerator
+{
+
+	// Children per wide node, and triangles per packet, as many as one AVX register holds in Real
+#ifdef BPT_SINGLE_PRECISION
+	constexpr uint8_t wide_width{ 8 };
+#else
+	constexpr uint8_t wide_width{ 4 };
+#endif
+
+	// Child bounds in structure of arrays layout, one lane per child
+	struct alignas( 64 ) WideNode
+	{
+		Real min_x[ wide_width ];
+		Real min_y[ wide_width ];
+		Real min_z[ wide_width ];
+		Real max_x[ wide_width ];
+		Real max_y[ wide_width ];
+		Real max_z[ wide_width ];
+		// Inner child: node index, leaf child: first packet index
+		uint32_t child[ wide_width ];
+		// Number of packets in a leaf child, zero for inner children
+		uint16_t count[ wide_width ];
+		// One bit per lane that holds a child
+		uint8_t valid{ 0 };
+	};
+
+	// Id of packet lanes that hold no triangle
+	constexpr uint32_t unused_id{ 0xffffffff };
+
+	// Triangles in structure of arrays layout, precomputed for Moller-Trumbore
+	// Unused lanes have zero edges, and are rejected by the determinant test
+	struct alignas( 64 ) TrianglePacket
+	{
+		Real position_x[ wide_width ];
+		Real position_y[ wide_width ];
+		Real position_z[ wide_width ];
+		Real edge1_x[ wide_width ];
+		Real edge1_y[ wide_width ];
+		Real edge1_z[ wide_width ];
+		Real edge2_x[ wide_width ];
+		Real edge2_y[ wide_width ];
+		Real edge2_z[ wide_width ];
+		// Index in the mesh, unused_id for unused lanes
+		uint32_t id[ wide_width ];
+
+		// Lanes that hold a triangle
+		uint8_t lanes() const
+		{
+			uint8_t n{ 0 };
+			for ( uint8_t lane = 0; lane < wide_width; ++lane )
+				n += id[ lane ] != unused_id;
+			return n;
+		};
+	};
+
+};
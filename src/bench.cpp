@@ -0,0 +1,524 @@
+// Copyright (c) 2024 Thomas Klietsch, all rights reserved.
+//
+// Licensed under the GNU Lesser General Public License, version 3.0 or later
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or ( at your option ) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General
+// Public License along with this program.If not, see < https://www.gnu.org/licenses/>.
+
+// Microbenchmarks of the hot paths, and full frames, results are written as JSON.
+// Timings come from a build without BPT_STATS, so they are of the shipped hot path. A build with it only renders each frame
+// once, untimed, and writes the rays traced, which the timed build reads with --rays to report rays per second.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <omp.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench/runner.h"
+#include "bxdf/lambert.h"
+#include "colour/colour.h"
+#include "dispatch/isa.h"
+#include "epsilon.h"
+#include "geometry/triangle.h"
+#include "mathematics/constant.h"
+#include "mathematics/vec3.h"
+#include "random/mersenne.h"
+#include "random/philox.h"
+#include "random/sobol.h"
+#include "ray/intersection.h"
+#include "ray/section.h"
+#include "ray/segment.h"
+#include "render/arguments.h"
+#include "render/config.h"
+#include "render/image.h"
+#include "render/scene.h"
+#include "sample/hemisphere.h"
+#include "stats/counters.h"
+
+namespace Bench
+{
+
+	// Inputs per call, so the loop overhead of the runner is amortised
+	constexpr uint32_t n_input{ 1024 };
+
+	// Generates the inputs, the same for every run
+	Random::Philox input_random( 0xbe7c );
+
+	Real3 random_point( Real3 const& low, Real3 const& high )
+	{
+		auto const [e1, e2] = input_random.get_float2();
+		float const e3 = input_random.get_float();
+		return Real3( low.x + ( high.x - low.x ) * e1, low.y + ( high.y - low.y ) * e2, low.z + ( high.z - low.z ) * e3 );
+	};
+
+	// UV sphere of at least n_triangle triangles, as OBJ so the scene is built through the loader like any input
+	std::string sphere_file(
+		uint32_t const& n_triangle
+	)
+	{
+		uint32_t const n_segment = static_cast<uint32_t>( std::ceil( std::sqrt( n_triangle / 2. ) ) );
+		std::string const file_name = ( std::filesystem::temp_directory_path() / ( "bpt_bench_sphere_" + std::to_string( n_triangle ) + ".obj" ) ).string();
+		std::ofstream file( file_name, std::ios::trunc );
+		for ( uint32_t i = 0; i <= n_segment; ++i )
+			for ( uint32_t j = 0; j < n_segment; ++j )
+			{
+				double const theta = pi * i / n_segment;
+				double const phi = 2. * pi * j / n_segment;
+				file << "v " << std::sin( theta ) * std::cos( phi ) << " " << std::sin( theta ) * std::sin( phi ) << " " << std::cos( theta ) << "\n";
+			}
+		for ( uint32_t i = 0; i < n_segment; ++i )
+			for ( uint32_t j = 0; j < n_segment; ++j )
+			{
+				uint32_t const a = i * n_segment + j + 1;
+				uint32_t const b = i * n_segment + ( j + 1 ) % n_segment + 1;
+				file << "f " << a << " " << a + n_segment << " " << b + n_segment << "\n";
+				file << "f " << a << " " << b + n_segment << " " << b << "\n";
+			}
+		return file ? file_name : std::string{};
+	};
+
+	void geometry(
+		Bench::Runner& runner
+	)
+	{
+		if ( !runner.f_enabled( "geometry/" ) )
+			return;
+
+		// Small triangles in the unit cube, rays from around it aimed near them, so some hit and some miss
+		std::vector<Geometry::Triangle> triangle;
+		std::vector<Ray::Section> ray;
+		for ( uint32_t i = 0; i < n_input; ++i )
+		{
+			Real3 const a = random_point( Real3( 0., 0., 0. ), Real3( 1., 1., 1. ) );
+			triangle.emplace_back( a, a + random_point( Real3( -.2, -.2, -.2 ), Real3( .2, .2, .2 ) ), a + random_point( Real3( -.2, -.2, -.2 ), Real3( .2, .2, .2 ) ) );
+			Real3 const origin = random_point( Real3( -2., -2., -2. ), Real3( 3., 3., 3. ) );
+			ray.emplace_back( origin, ( a + random_point( Real3( 0., 0., 0. ), Real3( .1, .1, .1 ) ) - origin ).normalise() );
+		}
+
+		runner.run( "geometry/triangle_intersect", "tests", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( triangle[ i ].intersect( ray[ i ] ) );
+			} );
+	};
+
+	// Whether any ray query on the scene of label runs, so building it can be skipped
+	bool f_scene(
+		Bench::Runner const& runner,
+		std::string const& label
+	)
+	{
+		for ( char const* query : { "intersect", "intersect_diffuse", "intersect_packet", "occluded", "occluded_batch", "occluded_loop" } )
+			if ( runner.f_enabled( "scene/" + std::string( query ) + "/" + label ) )
+				return true;
+		return false;
+	};
+
+	// Ray queries against a scene
+	void scene(
+		Bench::Runner& runner,
+		Render::Scene const& scene,
+		Render::Config const& config,
+		std::string const& label
+	)
+	{
+		if ( !f_scene( runner, label ) )
+			return;
+
+		std::string const prefix = "scene/";
+		std::string const suffix = "/" + label;
+		auto const add = [ & ]( Bench::Result* result )
+			{
+				if ( result )
+					result->extra = { { "triangles", static_cast<double>( scene.n_object() ) } };
+			};
+
+		// Camera rays through random pixels, and diffuse bounces and shadow segments from where they hit
+		std::vector<Ray::Section> camera;
+		std::vector<Ray::Section> bounce;
+		std::vector<Ray::Section> shadow;
+		std::vector<Real> shadow_distance;
+		std::vector<Real3> origin;
+		std::vector<Ray::Segment> segment;
+		constexpr uint8_t n_segment{ 16 };
+		Random::Philox random( 0xbe7c );
+		for ( uint32_t i = 0; camera.size() < n_input; ++i )
+		{
+			random.start( i, 0 );
+			auto const [e1, e2] = random.get_float2();
+			Ray::Section const ray = scene.camera_ray( static_cast<uint16_t>( e1 * config.image_width ), static_cast<uint16_t>( e2 * config.image_height ), random );
+			auto const [f_hit, distance, idata] = scene.intersect( ray );
+			if ( !f_hit )
+				continue;
+			camera.push_back( ray );
+
+			Real3 const direction = idata.orthogonal.to_world( Sample::CosineHemiSphere( random ) );
+			bounce.emplace_back( idata.offset( direction ), direction );
+
+			origin.push_back( idata.offset( idata.normal ) );
+			for ( uint8_t j = 0; j <= n_segment; ++j )
+			{
+				auto const [power, point, normal] = scene.light( ( i + j ) % scene.n_light() ).sample( random );
+				Real3 const diff = point - origin.back();
+				Real const length = std::max<Real>( diff.magnitude() - EPSILON_DISTANCE, EPSILON_DISTANCE );
+				if ( j == n_segment )
+				{
+					shadow.emplace_back( origin.back(), diff.normalise() );
+					shadow_distance.push_back( length );
+				}
+				else
+					segment.push_back( { diff.normalise(), length } );
+			}
+		}
+
+		add( runner.run( prefix + "intersect" + suffix, "rays", n_input, [ & ]()
+			{
+				for ( Ray::Section const& ray : camera )
+					Bench::keep( scene.intersect( ray ) );
+			} ) );
+
+		add( runner.run( prefix + "intersect_diffuse" + suffix, "rays", n_input, [ & ]()
+			{
+				for ( Ray::Section const& ray : bounce )
+					Bench::keep( scene.intersect( ray ) );
+			} ) );
+
+		// Packets of camera rays, as the wavefront integrator traces primary rays
+		std::vector<Real3> packet;
+		for ( Ray::Section const& ray : camera )
+			packet.push_back( ray.direction );
+		std::array<Ray::Intersection, Render::Scene::max_batch> idata;
+		add( runner.run( prefix + "intersect_packet" + suffix, "rays", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; i += Render::Scene::max_batch )
+					Bench::keep( scene.intersect( camera[ 0 ].origin, &packet[ i ], Render::Scene::max_batch, idata.data() ) );
+			} ) );
+
+		add( runner.run( prefix + "occluded" + suffix, "rays", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( scene.occluded( shadow[ i ], shadow_distance[ i ] ) );
+			} ) );
+
+		// Batches of shadow rays from one vertex, as emitter and subpath connections are made
+		add( runner.run( prefix + "occluded_batch" + suffix, "rays", n_input * n_segment, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( scene.occluded( origin[ i ], &segment[ i * n_segment ], n_segment ) );
+			} ) );
+
+		// The same segments one occluded call each, what the batch has to beat
+		add( runner.run( prefix + "occluded_loop" + suffix, "rays", n_input * n_segment, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					for ( uint8_t j = 0; j < n_segment; ++j )
+						Bench::keep( scene.occluded( Ray::Section( origin[ i ], segment[ i * n_segment + j ].direction ), segment[ i * n_segment + j ].distance ) );
+			} ) );
+	};
+
+	// Materials, emitters and the camera, at the surfaces of the scene
+	void sampling(
+		Bench::Runner& runner,
+		Render::Scene const& scene,
+		Render::Config const& config
+	)
+	{
+		std::vector<Ray::Intersection> hit;
+		std::vector<Real3> direction;
+		Random::Philox random( 0xbe7c );
+		for ( uint32_t i = 0; hit.size() < n_input; ++i )
+		{
+			random.start( i, 0 );
+			auto const [f_hit, distance, idata] = scene.intersect( scene.camera_ray( static_cast<uint16_t>( i % config.image_width ), static_cast<uint16_t>( i / config.image_width % config.image_height ), random ) );
+			if ( !f_hit )
+				continue;
+			hit.push_back( idata );
+			direction.push_back( random_point( Real3( -1., -1., -1. ), Real3( 1., 1., 1. ) ).normalise() );
+		}
+
+		BxDF::Lambert const lambert( Colour( 0.8f, 0.8f, 0.8f ) );
+		random.start( 0, 0 );
+		runner.run( "bxdf/lambert_sample", "samples", n_input, [ & ]()
+			{
+				for ( Ray::Intersection const& idata : hit )
+					Bench::keep( lambert.sample( idata, random ) );
+			} );
+
+		runner.run( "bxdf/lambert_evaluate", "evaluations", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( lambert.evaluate( direction[ i ], hit[ i ] ) );
+			} );
+
+		random.start( 0, 0 );
+		runner.run( "emitter/triangle_emit", "samples", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( scene.light( i % scene.n_light() ).emit( random ) );
+			} );
+
+		random.start( 0, 0 );
+		runner.run( "camera/generate_ray", "rays", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( scene.camera_ray( static_cast<uint16_t>( i % config.image_width ), static_cast<uint16_t>( i / config.image_width % config.image_height ), random ) );
+			} );
+	};
+
+	// A stream of numbers, and the start of a path: a restart then four pairs
+	void random(
+		Bench::Runner& runner,
+		std::string const& name,
+		Random::Polymorphic& random
+	)
+	{
+		random.start( 0, 0 );
+		runner.run( "random/" + name + "/get_float2", "pairs", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+					Bench::keep( random.get_float2() );
+			} );
+
+		runner.run( "random/" + name + "/start", "paths", n_input, [ & ]()
+			{
+				for ( uint32_t i = 0; i < n_input; ++i )
+				{
+					random.start( i, 7 );
+					for ( uint8_t j = 0; j < 4; ++j )
+						Bench::keep( random.get_float2() );
+				}
+			} );
+	};
+
+	// Rays traced by a frame, keyed by its name and every setting the count depends on
+	using RayCount = std::map<std::string, uint64_t>;
+
+	std::string frame_key(
+		std::string const& name,
+		Render::Config const& config
+	)
+	{
+		std::ostringstream key;
+		key << "frame/" << name << " " << config.image_width << "x" << config.image_height << " samples " << config.max_samples << " depth " << static_cast<int>( config.max_depth )
+			<< " roulette " << static_cast<int>( config.roulette_depth ) << " light " << config.light_samples << " tree " << config.light_tree_samples << " pool " << config.light_pool_size
+			<< " connections " << static_cast<int>( config.light_pool_connections ) << " sampler " << ( config.f_sobol ? "sobol" : "philox" ) << " seed " << config.seed
+			<< " mirror " << config.f_mirror_block << " scene " << config.scene_file;
+		return key.str();
+	};
+
+	// One line per frame, the key, a tab, then the count
+	bool save_rays(
+		std::string const& file_name,
+		Bench::RayCount const& count
+	)
+	{
+		std::ofstream file( file_name, std::ios::trunc );
+		for ( auto const& [key, n] : count )
+			file << key << "\t" << n << "\n";
+		return static_cast<bool>( file );
+	};
+
+	Bench::RayCount load_rays(
+		std::string const& file_name
+	)
+	{
+		Bench::RayCount count;
+		std::ifstream file( file_name );
+		std::string line;
+		while ( std::getline( file, line ) )
+			if ( size_t const tab = line.rfind( '\t' ); tab != std::string::npos )
+				count[ line.substr( 0, tab ) ] = std::strtoull( line.c_str() + tab + 1, nullptr, 10 );
+		return count;
+	};
+
+	// A whole image, rendered from scratch, with samples per second, and rays per second if the counting build has counted the frame
+	void frame(
+		Bench::Runner& runner,
+		Render::Scene const& scene,
+		Render::Config const& config,
+		std::string const& name,
+		Bench::RayCount& ray_count
+	)
+	{
+#ifdef BPT_STATS
+		// The image is the same whatever the threads do, so is the number of rays
+		if ( !runner.f_enabled( "frame/" + name ) )
+			return;
+		Render::Image image( scene, config );
+		image.render();
+		ray_count[ Bench::frame_key( name, config ) ] = image.stats()[ Stats::Counter::intersect_rays ] + image.stats()[ Stats::Counter::occluded_rays ];
+#else
+		uint64_t const n_sample = static_cast<uint64_t>( config.image_width ) * config.image_height * config.max_samples;
+		Bench::Result* result = runner.run( "frame/" + name, "samples", n_sample, [ & ]()
+			{
+				Render::Image image( scene, config );
+				image.render();
+			} );
+		if ( !result )
+			return;
+
+		double const seconds = result->median * 1e-9 * static_cast<double>( n_sample );
+		result->extra = { { "samples_per_second", static_cast<double>( n_sample ) / seconds } };
+		Bench::RayCount::const_iterator const n = ray_count.find( Bench::frame_key( name, config ) );
+		if ( n == ray_count.end() )
+			return;
+		double const n_ray = static_cast<double>( n->second );
+		result->extra.push_back( { "rays_per_frame", n_ray } );
+		result->extra.push_back( { "mrays_per_second", n_ray / seconds * 1e-6 } );
+		std::cout << std::string( 40, ' ' ) << std::setprecision( 3 ) << n_ray / seconds * 1e-6 << " Mrays/s" << std::endl;
+#endif
+	};
+
+};
+
+int main( int argc, char* argv[] )
+{
+	std::string file_name{ "bench.json" };
+	// Rays per frame, written by the counting build and read by the timed one
+	std::string ray_file;
+	std::string filter;
+	double min_time{ 0.1 };
+	uint32_t repetitions{ 7 };
+	Render::Config config( 256, 256, 1, 5 );
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		// Render settings apply to the scenes and frames
+		Render::Argument const parsed = Render::parse_argument( argc, argv, i, config );
+		if ( parsed == Render::Argument::invalid )
+			return EXIT_FAILURE;
+		if ( parsed == Render::Argument::used )
+			continue;
+
+		std::string const argument( argv[ i ] );
+		// Only run benchmarks whose name contains this
+		if ( ( argument == "--filter" ) && ( i + 1 < argc ) )
+			filter = argv[ ++i ];
+		// JSON results
+		else if ( ( argument == "--out" ) && ( i + 1 < argc ) )
+			file_name = argv[ ++i ];
+		// Rays per frame, see the top of this file
+		else if ( ( argument == "--rays" ) && ( i + 1 < argc ) )
+			ray_file = argv[ ++i ];
+		// Seconds each repetition runs for at least
+		else if ( ( argument == "--min-time" ) && ( i + 1 < argc ) )
+			min_time = std::max( std::atof( argv[ ++i ] ), 0.001 );
+		// Timed repetitions, the median is reported
+		else if ( ( argument == "--repetitions" ) && ( i + 1 < argc ) )
+			repetitions = static_cast<uint32_t>( std::max( std::atoi( argv[ ++i ] ), 1 ) );
+		// Edge length of the square frames
+		else if ( ( argument == "--size" ) && ( i + 1 < argc ) )
+			config.image_width = config.image_height = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 16, 4096 ) );
+		else
+		{
+			std::cout << "Unknown argument " << argument << "." << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	Bench::Runner runner( min_time, repetitions, filter );
+	Bench::RayCount ray_count;
+
+#ifdef BPT_STATS
+	// Counting build, the counters would make any timing unrepresentative
+	if ( ray_file.empty() )
+	{
+		std::cout << "The counting build needs --rays <file> to write to." << std::endl;
+		return EXIT_FAILURE;
+	}
+	Render::Scene const cornell( config );
+	Bench::frame( runner, cornell, config, "bpt", ray_count );
+	{
+		Render::Config wavefront_config( config );
+		wavefront_config.f_wavefront = true;
+		Bench::frame( runner, cornell, wavefront_config, "wavefront", ray_count );
+	}
+	if ( !Bench::save_rays( ray_file, ray_count ) )
+	{
+		std::cout << "Could not write " << ray_file << "." << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Rays per frame written to " << ray_file << "." << std::endl;
+	return EXIT_SUCCESS;
+#else
+	if ( !ray_file.empty() )
+		ray_count = Bench::load_rays( ray_file );
+
+	Bench::geometry( runner );
+
+	{
+		Random::Philox philox( 0xbe7c );
+		Random::Sobol sobol( 0xbe7c );
+		Random::Mersenne mersenne( 0xbe7c );
+		Bench::random( runner, "philox", philox );
+		Bench::random( runner, "sobol", sobol );
+		Bench::random( runner, "mersenne", mersenne );
+	}
+
+	// The Cornell box, then spheres of growing size in place of the blocks
+	Render::Scene const cornell( config );
+	Bench::scene( runner, cornell, config, "cornell" );
+	for ( uint32_t const n_triangle : { 1u << 12, 1u << 16, 1u << 19 } )
+	{
+		std::string const label = "sphere_" + std::to_string( n_triangle );
+		if ( !Bench::f_scene( runner, label ) )
+			continue;
+		Render::Config sphere_config( config );
+		sphere_config.scene_file = Bench::sphere_file( n_triangle );
+		if ( sphere_config.scene_file.empty() )
+			continue;
+		Render::Scene const sphere( sphere_config );
+		std::filesystem::remove( sphere_config.scene_file );
+		Bench::scene( runner, sphere, config, label );
+	}
+
+	if ( runner.f_enabled( "bxdf/" ) || runner.f_enabled( "emitter/" ) || runner.f_enabled( "camera/" ) )
+		Bench::sampling( runner, cornell, config );
+
+	if ( runner.f_enabled( "image/save" ) )
+	{
+		Render::Image image( cornell, config );
+		image.render();
+		std::string const image_name = ( std::filesystem::temp_directory_path() / "bpt_bench_image" ).string();
+		runner.run( "image/save", "images", 1, [ & ]() { Bench::keep( image.save( image_name ) ); } );
+		std::filesystem::remove( image_name + ".tga" );
+	}
+
+	Bench::frame( runner, cornell, config, "bpt", ray_count );
+	{
+		Render::Config wavefront_config( config );
+		wavefront_config.f_wavefront = true;
+		Bench::frame( runner, cornell, wavefront_config, "wavefront", ray_count );
+	}
+
+	if ( !runner.save( file_name, { { "isa", Dispatch::name( config.isa ) }, { "precision", sizeof( Real ) == sizeof( float ) ? "single" : "double" },
+		{ "threads", std::to_string( omp_get_max_threads() ) }, { "frame", std::to_string( config.image_width ) + "x" + std::to_string( config.image_height ) }, { "compiler", __VERSION__ }, { "rays", ray_count.empty() ? "not counted" : "counted by the BPT_STATS build in " + ray_file } } ) )
+	{
+		std::cout << "Could not write " << file_name << "." << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Results written to " << file_name << "." << std::endl;
+	return EXIT_SUCCESS;
+#endif
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../colour/colour.h"
+
+namespace Bench
+{
+
+	// Linear image stored as a Portable Float Map, little endian RGB rows from the bottom up
+	inline bool save_pfm(
+		std::string const& file_name,
+		std::span<Colour const> pixel,
+		uint16_t const& width,
+		uint16_t const& height
+	)
+	{
+		std::ofstream file( file_name, std::ios::trunc | std::ios::binary );
+		if ( !file || ( pixel.size() != static_cast<size_t>( width ) * height ) )
+			return false;
+		file << "PF\n" << width << " " << height << "\n-1.0\n";
+		for ( uint32_t y = height; y-- > 0; )
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				Colour const& c = pixel[ x + y * width ];
+				float const rgb[ 3 ] = { c.r, c.g, c.b };
+				file.write( reinterpret_cast<char const*>( rgb ), sizeof( rgb ) );
+			}
+		return static_cast<bool>( file );
+	};
+
+	// Empty if the file is missing, or not a little endian PFM of width by height
+	inline std::vector<Colour> load_pfm(
+		std::string const& file_name,
+		uint16_t const& width,
+		uint16_t const& height
+	)
+	{
+		std::ifstream file( file_name, std::ios::binary );
+		std::string magic;
+		uint32_t file_width{ 0 };
+		uint32_t file_height{ 0 };
+		float scale{ 0.f };
+		if ( !( file >> magic >> file_width >> file_height >> scale ) || ( magic != "PF" ) || ( file_width != width ) || ( file_height != height ) || ( scale >= 0.f ) )
+			return {};
+		file.get();
+
+		std::vector<Colour> pixel( static_cast<size_t>( width ) * height );
+		for ( uint32_t y = height; y-- > 0; )
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				float rgb[ 3 ];
+				file.read( reinterpret_cast<char*>( rgb ), sizeof( rgb ) );
+				pixel[ x + y * width ] = Colour( rgb[ 0 ], rgb[ 1 ], rgb[ 2 ] );
+			}
+		return file ? pixel : std::vector<Colour>{};
+	};
+
+	struct Error
+	{
+		// Root mean squared error, over pixels and channels
+		double rmse{ 0. };
+		// Squared error relative to the squared reference, so dark and bright regions count alike
+		double relmse{ 0. };
+	};
+
+	// Error of image against reference, relmse adds epsilon to the squared reference so black pixels do not dominate
+	inline Bench::Error error(
+		std::span<Colour const> image,
+		std::span<Colour const> reference,
+		double const epsilon = 1e-2
+	)
+	{
+		double square{ 0. };
+		double relative{ 0. };
+		size_t const n = std::min( image.size(), reference.size() );
+		for ( size_t i = 0; i < n; ++i )
+		{
+			float const a[ 3 ] = { image[ i ].r, image[ i ].g, image[ i ].b };
+			float const b[ 3 ] = { reference[ i ].r, reference[ i ].g, reference[ i ].b };
+			for ( uint8_t c = 0; c < 3; ++c )
+			{
+				double const d = static_cast<double>( a[ c ] ) - b[ c ];
+				square += d * d;
+				relative += d * d / ( static_cast<double>( b[ c ] ) * b[ c ] + epsilon );
+			}
+		}
+		double const samples = std::max<double>( 3. * n, 1. );
+		return { std::sqrt( square / samples ), relative / samples };
+	};
+
+};
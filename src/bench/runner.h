@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../dispatch/isa.h"
+
+namespace Bench
+{
+
+	// Keeps the compiler from dropping a computation whose result is otherwise unused
+	template<typename T>
+	FORCE_INLINE void keep( T const& value )
+	{
+		asm volatile( "" : : "g"( &value ) : "memory" );
+	};
+
+	struct Result
+	{
+		std::string name;
+		// Operations per second are reported as ops, rays, samples, ...
+		std::string unit;
+		// Nano seconds per operation over the repetitions
+		double median{ 0. };
+		double min{ 0. };
+		double max{ 0. };
+		// Median absolute deviation, relative to the median
+		double spread{ 0. };
+		uint64_t iterations{ 0 };
+		uint32_t repetitions{ 0 };
+		// Further figures, e.g. rays per second of a frame
+		std::vector< std::pair<std::string, double> > extra;
+	};
+
+	// Times a body that does a fixed number of operations per call.
+	// The call count of a repetition is doubled until it takes min_time, after a warm up,
+	// then the repetitions are timed, and the median is reported as it is robust to the odd interruption.
+	class Runner final
+	{
+
+	private:
+
+		double min_time{ 0.1 };
+		uint32_t repetitions{ 7 };
+		std::string filter;
+
+		std::vector<Bench::Result> result;
+
+	public:
+
+		Runner() = delete;
+
+		Runner(
+			double const& min_time,
+			uint32_t const& repetitions,
+			std::string const& filter
+		)
+			: min_time( min_time ), repetitions( std::max<uint32_t>( repetitions, 1 ) ), filter( filter )
+		{};
+
+		// Only benchmarks whose name contains the filter run, so expensive setup can be skipped as well
+		bool f_enabled( std::string const& name ) const
+		{
+			return filter.empty() || ( name.find( filter ) != std::string::npos );
+		};
+
+		template<typename Body>
+		Bench::Result* run(
+			std::string const& name,
+			std::string const& unit,
+			uint64_t const& ops_per_call,
+			Body&& body
+		)
+		{
+			if ( !f_enabled( name ) )
+				return nullptr;
+
+			auto const time = [ & ]( uint64_t const& calls )
+				{
+					std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+					for ( uint64_t i = 0; i < calls; ++i )
+						body();
+					return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+				};
+
+			uint64_t calls{ 1 };
+			while ( ( time( calls ) < min_time ) && ( calls < ( 1ull << 40 ) ) )
+				calls *= 2;
+
+			std::vector<double> ns;
+			for ( uint32_t i = 0; i < repetitions; ++i )
+				ns.push_back( time( calls ) * 1e9 / static_cast<double>( calls * ops_per_call ) );
+
+			Bench::Result r;
+			r.name = name;
+			r.unit = unit;
+			r.median = median( ns );
+			r.min = *std::min_element( ns.begin(), ns.end() );
+			r.max = *std::max_element( ns.begin(), ns.end() );
+			for ( double& t : ns )
+				t = std::abs( t - r.median );
+			r.spread = median( ns ) / r.median;
+			r.iterations = calls * ops_per_call;
+			r.repetitions = repetitions;
+			result.push_back( r );
+
+			std::cout << std::left << std::setw( 40 ) << name << std::right << std::setw( 12 ) << std::fixed << std::setprecision( 2 ) << r.median << " ns/op"
+				<< std::setw( 12 ) << std::setprecision( 3 ) << 1e3 / r.median << " M" << unit << "/s  +-" << std::setprecision( 1 ) << r.spread * 100. << "%" << std::endl;
+			return &result.back();
+		};
+
+		// Results, and the build they come from, as JSON
+		bool save(
+			std::string const& file_name,
+			std::vector< std::pair<std::string, std::string> > const& context
+		) const
+		{
+			std::ofstream file( file_name, std::ios::trunc );
+			if ( !file )
+				return false;
+
+			file << std::setprecision( 6 ) << "{\n\t\"context\": {";
+			for ( size_t i = 0; i < context.size(); ++i )
+				file << ( i ? ", " : " " ) << "\"" << context[ i ].first << "\": \"" << context[ i ].second << "\"";
+			file << " },\n\t\"benchmarks\": [";
+			for ( size_t i = 0; i < result.size(); ++i )
+			{
+				Bench::Result const& r = result[ i ];
+				file << ( i ? "," : "" ) << "\n\t\t{ \"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"ns_per_op\": " << r.median
+					<< ", \"min\": " << r.min << ", \"max\": " << r.max << ", \"spread\": " << r.spread
+					<< ", \"per_second\": " << 1e9 / r.median << ", \"iterations\": " << r.iterations << ", \"repetitions\": " << r.repetitions;
+				for ( auto const& [key, value] : r.extra )
+					file << ", \"" << key << "\": " << value;
+				file << " }";
+			}
+			file << "\n\t]\n}\n";
+			return static_cast<bool>( file );
+		};
+
+	private:
+
+		static double median( std::vector<double> v )
+		{
+			std::sort( v.begin(), v.end() );
+			return v.size() % 2 ? v[ v.size() / 2 ] : 0.5 * ( v[ v.size() / 2 - 1 ] + v[ v.size() / 2 ] );
+		};
+
+	};
+
+};
@@ -5,7 +5,7 @@
 #include "../bxdf/common.h"
 #include "../bxdf/polymorphic.h"
 #include "../colour/colour.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../ray/intersection.h"
 
@@ -29,24 +29,41 @@ namespace BxDF
 			: energy( energy )
 		{};
 
-		std::tuple<Colour, Double3, BxDF::Event> sample(
+		std::tuple<Colour, Real3, BxDF::Event, float> sample(
 			Ray::Intersection const& idata,
 			Random::Polymorphic &random
 		) const override
 		{
 			// Direct hit on emitter is not affected by surface area,
 			// nor does it generate a new direction
-			return { energy, {}, BxDF::Event::Emission };
+			// One sided, like the emitters, which only emit towards their normal
+			return { idata.local_wray.z > 0 ? energy : Colour::Black, {}, BxDF::Event::Emission, 0.f };
 		};
 
 		Colour evaluate(
-			Double3 const& evaluate_direction,
+			Real3 const& evaluate_direction,
 			Ray::Intersection const& idata
 		) const override
 		{
 			return Colour::Black;
 		};
 
+		float pdf(
+			Real3 const&,
+			Ray::Intersection const&
+		) const override
+		{
+			return 0.f;
+		};
+
+		float pdf_reverse(
+			Real3 const&,
+			Ray::Intersection const&
+		) const override
+		{
+			return 0.f;
+		};
+
 	};
 
 };
@@ -1,12 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <tuple>
 
 #include "../bxdf/common.h"
 #include "../bxdf/polymorphic.h"
 #include "../colour/colour.h"
 #include "../mathematics/constant.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../ray/intersection.h"
 #include "../sample/hemisphere.h"
@@ -31,23 +32,44 @@ namespace BxDF
 			: albedo( albedo )
 		{};
 
-		std::tuple<Colour, Double3, BxDF::Event> sample(
+		// Cosine weighted, so bxdf * cos / pdf is the albedo
+		std::tuple<Colour, Real3, BxDF::Event, float> sample(
 			Ray::Intersection const& idata,
 			Random::Polymorphic& random
 		) const override
 		{
-			Double3 const sample_direction = Sample::HemiSphere( random );
-			return { albedo * sample_direction.z, idata.orthogonal.to_world( sample_direction ), BxDF::Event::Diffuse };
+			Real3 const sample_direction = Sample::CosineHemiSphere( random );
+			// Tangent to the surface, zero pdf
+			if ( sample_direction.z <= 0. )
+				return { Colour::Black, {}, BxDF::Event::None, 0.f };
+			return { albedo, idata.orthogonal.to_world( sample_direction ), BxDF::Event::Diffuse, static_cast<float>( sample_direction.z ) * inv_pi };
 		};
 
 		Colour evaluate(
-			Double3 const& evaluate_direction,
+			Real3 const& evaluate_direction,
 			Ray::Intersection const& idata
 		) const override
 		{
 			// One sided material
-			double const cos_theta = evaluate_direction.dot( idata.normal );
-			return cos_theta > 0 ? albedo * cos_theta : Colour::Black;
+			Real const cos_theta = evaluate_direction.dot( idata.normal );
+			return cos_theta > 0 ? albedo * ( static_cast<float>( cos_theta ) * inv_pi ) : Colour::Black;
+		};
+
+		float pdf(
+			Real3 const& direction,
+			Ray::Intersection const& idata
+		) const override
+		{
+			return std::max( 0.f, static_cast<float>( direction.dot( idata.normal ) ) ) * inv_pi;
+		};
+
+		// Only depends on the direction the ray came from
+		float pdf_reverse(
+			Real3 const&,
+			Ray::Intersection const& idata
+		) const override
+		{
+			return std::max( 0.f, static_cast<float>( idata.local_wray.z ) ) * inv_pi;
 		};
 
 	};
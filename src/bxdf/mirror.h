@@ -6,8 +6,8 @@
 #include "../bxdf/common.h"
 #include "../bxdf/polymorphic.h"
 #include "../colour/colour.h"
-#include "../mathematics/double3.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../ray/intersection.h"
 
@@ -30,23 +30,39 @@ namespace BxDF
 			: reflectance( reflectance )
 		{};
 
-		std::tuple<Colour, Double3, BxDF::Event> sample(
+		std::tuple<Colour, Real3, BxDF::Event, float> sample(
 			Ray::Intersection const& idata,
 			Random::Polymorphic &random
 		) const override
 		{
-			Double3 const wsample_local( -idata.local_wray.x, -idata.local_wray.y, idata.local_wray.z );
-			return { reflectance, idata.orthogonal.to_world( wsample_local ), BxDF::Event::Reflect };
+			Real3 const wsample_local( -idata.local_wray.x, -idata.local_wray.y, idata.local_wray.z );
+			return { reflectance, idata.orthogonal.to_world( wsample_local ), BxDF::Event::Reflect, 0.f };
 		};
 
 		Colour evaluate(
-			Double3 const& evaluate_direction,
+			Real3 const& evaluate_direction,
 			Ray::Intersection const& idata
 		) const override
 		{
 			return Colour::Black;
 		};
 
+		float pdf(
+			Real3 const&,
+			Ray::Intersection const&
+		) const override
+		{
+			return 0.f;
+		};
+
+		float pdf_reverse(
+			Real3 const&,
+			Ray::Intersection const&
+		) const override
+		{
+			return 0.f;
+		};
+
 	};
 
 };
@@ -5,7 +5,7 @@
 
 #include "../bxdf/common.h"
 #include "../colour/colour.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../ray/intersection.h"
 
@@ -17,13 +17,27 @@ namespace BxDF
 
 	public:
 
-		virtual std::tuple<Colour, Double3, BxDF::Event> sample(
+		// Weight ( bxdf * cos / pdf ), direction, event, and the solid angle pdf of direction, zero for dirac events
+		virtual std::tuple<Colour, Real3, BxDF::Event, float> sample(
 			Ray::Intersection const& idata,
 			Random::Polymorphic &random
 		) const = 0;
 
+		// bxdf * cos, towards evaluate_direction
 		virtual Colour evaluate(
-			Double3 const& evaluate_direction,
+			Real3 const& evaluate_direction,
+			Ray::Intersection const& idata
+		) const = 0;
+
+		// Solid angle pdf of sample returning direction
+		virtual float pdf(
+			Real3 const& direction,
+			Ray::Intersection const& idata
+		) const = 0;
+
+		// Solid angle pdf of sample returning the direction the ray came from, had it arrived from direction
+		virtual float pdf_reverse(
+			Real3 const& direction,
 			Ray::Intersection const& idata
 		) const = 0;
 
@@ -0,0 +1,241 @@
+// Copyright (c) 2024 Thomas Klietsch, all rights reserved.
+//
+// Licensed under the GNU Lesser General Public License, version 3.0 or later
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or ( at your option ) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General
+// Public License along with this program.If not, see < https://www.gnu.org/licenses/>.
+
+// Checks of the acceleration structures on meshes the renderer's scenes do not exercise, and of the mesh loader on malformed files.
+// Each check prints its result, the program fails if any does.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "accelerator/bvh.h"
+#include "accelerator/depth.h"
+#include "accelerator/wide_bvh.h"
+#include "dispatch/isa.h"
+#include "geometry/mesh.h"
+#include "loader/load.h"
+#include "mathematics/vec3.h"
+#include "random/philox.h"
+#include "ray/section.h"
+#include "ray/segment.h"
+
+namespace Check
+{
+
+	// Triangles perpendicular to the x, y and z axis in turn, at offsets shrinking by 2.6 per triangle, so by over 16 per axis.
+	// The farthest centre is then alone in the last bin, and all others in the first, so every SAH split cuts off one triangle.
+	// Unbounded, the build is as deep as the mesh is large.
+	constexpr uint32_t n_skewed{ 120 };
+
+	Geometry::Mesh skewed_mesh()
+	{
+		Geometry::Mesh mesh;
+		for ( uint32_t i = 0; i < n_skewed; ++i )
+		{
+			Real const offset = static_cast<Real>( std::pow( 2.6, -static_cast<double>( i ) ) );
+			Real3 vertex[ 3 ] = { Real3( offset, -1, -1 ), Real3( offset, 1, -1 ), Real3( offset, 0, 1 ) };
+			for ( Real3& v : vertex )
+				if ( i % 3 == 1 )
+					v = Real3( v.z, v.x, v.y );
+				else if ( i % 3 == 2 )
+					v = Real3( v.y, v.z, v.x );
+			mesh.add( vertex[ 0 ], vertex[ 1 ], vertex[ 2 ], 0 );
+		}
+		return mesh;
+	};
+
+	// Depth of the deepest node of the binary tree, the root is at depth 0
+	uint32_t depth(
+		std::vector<Accelerator::BVH::Node> const& node,
+		uint32_t const id
+	)
+	{
+		if ( node[ id ].count > 0 )
+			return 0;
+		return 1 + std::max( depth( node, id + 1 ), depth( node, node[ id ].offset ) );
+	};
+
+	// Rays from around the mesh through its centre region, the same for every check
+	std::vector<Ray::Section> rays(
+		uint32_t const count
+	)
+	{
+		Random::Philox random( 0xc4ec );
+		auto const uniform = [ & ]( Real const scale ) { return scale * ( 2 * static_cast<Real>( random.get_float() ) - 1 ); };
+		std::vector<Ray::Section> ray;
+		ray.reserve( count );
+		for ( uint32_t i = 0; i < count; ++i )
+		{
+			Real3 const origin( uniform( 2 ), uniform( 2 ), uniform( 2 ) );
+			Real3 const target( uniform( 1 ), uniform( 1 ), uniform( 1 ) );
+			ray.push_back( Ray::Section( origin, ( target - origin ).normalise() ) );
+		}
+		return ray;
+	};
+
+	// Closest hit by testing every triangle
+	std::tuple<bool, Real> brute_force(
+		Geometry::Mesh const& mesh,
+		Ray::Section const& ray
+	)
+	{
+		bool f_hit{ false };
+		Real distance{ 1e20 };
+		for ( uint32_t i = 0; i < mesh.size(); ++i )
+		{
+			Real const d = mesh[ i ].intersect( ray );
+			if ( d > 0.0 && d < distance )
+			{
+				distance = d;
+				f_hit = true;
+			}
+		}
+		return { f_hit, distance };
+	};
+
+	bool report(
+		std::string const& name,
+		bool const f_pass
+	)
+	{
+		std::cout << ( f_pass ? "pass " : "FAIL " ) << name << std::endl;
+		return f_pass;
+	};
+
+	// The build stays within the depth the traversal stacks are sized for, and traversal agrees with testing every triangle
+	bool skewed_bvh()
+	{
+		Geometry::Mesh mesh = skewed_mesh();
+		Accelerator::BVH const bvh( mesh );
+		mesh.reorder( bvh.primitive_ids() );
+
+		bool f_pass = report( "skewed bvh depth within max_depth", depth( bvh.nodes(), 0 ) <= Accelerator::max_depth );
+
+		uint32_t n_hit{ 0 };
+		uint32_t n_wrong{ 0 };
+		for ( Ray::Section const& ray : rays( 10000 ) )
+		{
+			auto const [f_expected, expected] = brute_force( mesh, ray );
+			auto const [f_hit, distance, id] = bvh.intersect( mesh, ray, 1e20 );
+			bool const f_occluded = bvh.occluded( mesh, ray, 1e20 );
+			if ( ( f_hit != f_expected ) || ( f_hit && ( distance != expected ) ) || ( f_occluded != f_expected ) )
+				++n_wrong;
+			n_hit += f_expected;
+		}
+		f_pass &= report( "skewed bvh hits as testing every triangle", ( n_wrong == 0 ) && ( n_hit > 0 ) );
+
+		// The wide tree is collapsed from the deep binary one, in every kernel variant the processor runs.
+		// The SIMD tests may round differently, so distances only need to agree closely.
+		for ( Dispatch::ISA const isa : { Dispatch::ISA::SSE2, Dispatch::ISA::AVX2, Dispatch::ISA::AVX512 } )
+		{
+			if ( !Dispatch::supported( isa ) )
+				continue;
+			Accelerator::WideBVH const wide_bvh( bvh, mesh, isa );
+			std::vector<Ray::Section> const ray = rays( 10000 );
+			n_wrong = 0;
+			for ( Ray::Section const& r : ray )
+			{
+				auto const [f_expected, expected] = brute_force( mesh, r );
+				auto const [f_hit, distance, id] = wide_bvh.intersect( r, 1e20 );
+				if ( ( f_hit != f_expected ) || ( f_hit && ( std::abs( distance - expected ) > 1e-4 * expected ) ) || ( wide_bvh.occluded( r, 1e20 ) != f_expected ) )
+					++n_wrong;
+			}
+
+			// Packets and shadow batches of 64 rays from a shared origin
+			constexpr uint8_t n_packet{ 64 };
+			for ( uint32_t first = 0; first + n_packet <= ray.size(); first += n_packet )
+			{
+				Real3 direction[ n_packet ];
+				Real distance[ n_packet ];
+				uint32_t object_id[ n_packet ];
+				Ray::Segment segment[ n_packet ];
+				for ( uint8_t i = 0; i < n_packet; ++i )
+				{
+					direction[ i ] = ray[ first + i ].direction;
+					distance[ i ] = 1e20;
+					segment[ i ].direction = direction[ i ];
+					segment[ i ].distance = 1e20;
+				}
+				Real3 const& origin = ray[ first ].origin;
+				uint64_t const f_hit = wide_bvh.intersect( origin, direction, n_packet, distance, object_id );
+				uint64_t const f_occluded = wide_bvh.occluded( origin, segment, n_packet );
+				for ( uint8_t i = 0; i < n_packet; ++i )
+				{
+					auto const [f_expected, expected] = brute_force( mesh, Ray::Section( origin, direction[ i ] ) );
+					bool const f_ray_hit = ( f_hit >> i ) & 1;
+					if ( ( f_ray_hit != f_expected ) || ( f_ray_hit && ( std::abs( distance[ i ] - expected ) > 1e-4 * expected ) ) || ( ( ( f_occluded >> i ) & 1 ) != f_expected ) )
+						++n_wrong;
+				}
+			}
+			f_pass &= report( "skewed wide bvh hits as testing every triangle, " + Dispatch::name( isa ), n_wrong == 0 );
+		}
+		return f_pass;
+	};
+
+	// Binary PLY with the given header lines and body bytes, loaded from a temporary file
+	bool load_ply(
+		std::string const& header,
+		std::string const& body
+	)
+	{
+		std::string const file_name = ( std::filesystem::temp_directory_path() / "bpt_check.ply" ).string();
+		{
+			std::ofstream file( file_name, std::ios::binary );
+			file << "ply\nformat binary_little_endian 1.0\n" << header << "end_header\n" << body;
+		}
+		Geometry::Mesh mesh;
+		bool const f_loaded = Loader::load( file_name, mesh, Loader::Options{ { "default" }, {} } );
+		std::filesystem::remove( file_name );
+		return f_loaded;
+	};
+
+	// Element counts from the header are not trusted, rows they claim past the end of the file are rejected
+	bool ply_header()
+	{
+		std::string const face = "element face 1\nproperty list uchar int vertex_indices\n";
+		std::string const xyz = "property float x\nproperty float y\nproperty float z\n";
+		// One triangle, three vertices and a face row
+		std::string body( 3 * 12, '\0' );
+		body += std::string( 1, 3 ) + std::string( 12, '\0' );
+
+		bool f_pass = report( "ply well formed loads", load_ply( "element vertex 3\n" + xyz + face, body ) );
+		f_pass &= report( "ply truncated vertices rejected", !load_ply( "element vertex 5\n" + xyz + face, body ) );
+		// Count times stride does not fit in size_t
+		f_pass &= report( "ply overflowing vertex count rejected", !load_ply( "element vertex 1537228672809129302\n" + xyz + face, body ) );
+		// Count times stride wraps the offset back inside the file
+		f_pass &= report( "ply wrapping element count rejected", !load_ply( "element vertex 100000\n" + xyz + "element pad 18446744073708351616\nproperty uchar p\n" + face, body ) );
+		return f_pass;
+	};
+
+};
+
+int main()
+{
+	bool f_pass{ true };
+	f_pass &= Check::skewed_bvh();
+	f_pass &= Check::ply_header();
+
+	std::cout << ( f_pass ? "All checks passed." : "Some checks failed." ) << std::endl;
+	return f_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+};
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <utility>
 
+#include "../dispatch/isa.h"
 #include "../epsilon.h"
 
 struct Colour
@@ -28,6 +29,12 @@ struct Colour
 
 	bool is_black() const { return std::max( { r, g, b } ) < EPSILON_BLACK; };
 
+	// Inlined, also into the large integrator variants where the inliner would give up
+	FORCE_INLINE float max_component() const { return std::max( { r, g, b } ); };
+
+	// Rec. 709 weights
+	float luminance() const { return 0.2126f * r + 0.7152f * g + 0.0722f * b; };
+
 	// Limit values to [0;1]
 	Colour clamp()
 	{
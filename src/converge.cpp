@@ -0,0 +1,314 @@
+// Copyright (c) 2024 Thomas Klietsch, all rights reserved.
+//
+// Licensed under the GNU Lesser General Public License, version 3.0 or later
+//
+// This program is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or ( at your option ) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General
+// Public License along with this program.If not, see < https://www.gnu.org/licenses/>.
+
+// Error against a high sample reference at growing time budgets, for the Cornell box with a diffuse and a mirror tall block.
+// Integrator and sampler settings are taken as for the renderer. The references only depend on the scene, size and depth,
+// and are rendered once with a fixed conservative configuration, then stored with a description of it and the build.
+// A stored reference of other settings is refused, one of another build is used with a warning.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <omp.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench/reference.h"
+#include "dispatch/isa.h"
+#include "render/arguments.h"
+#include "render/config.h"
+#include "render/image.h"
+#include "render/scene.h"
+
+namespace Bench
+{
+
+	struct Point
+	{
+		float budget{ 0.f };
+		double seconds{ 0. };
+		uint32_t passes{ 0 };
+		Bench::Error error;
+	};
+
+	struct Curve
+	{
+		std::string variant{};
+		std::string reference{};
+		std::vector<Bench::Point> point{};
+	};
+
+#ifdef BPT_REVISION
+	std::string const revision{ BPT_REVISION };
+#else
+	std::string const revision{ "unknown" };
+#endif
+
+	// Independent numbers, no Russian roulette, no light pool and every emitter sampled directly, so a bias of a newer
+	// technique does not end up in the reference too. Another seed, as candidates with the default one would otherwise
+	// take the first samples of the reference.
+	Render::Config reference_config(
+		Render::Config const& config,
+		uint16_t const& samples
+	)
+	{
+		Render::Config reference_config( config.image_width, config.image_height, samples, config.max_depth );
+		reference_config.f_mirror_block = config.f_mirror_block;
+		reference_config.isa = config.isa;
+		reference_config.f_sobol = false;
+		reference_config.seed = ~Render::Config().seed;
+		reference_config.roulette_depth = std::numeric_limits<uint8_t>::max();
+		reference_config.light_pool_size = 0;
+		reference_config.light_samples = 1024;
+		return reference_config;
+	};
+
+	// Settings a reference is rendered with, one per line
+	std::string reference_settings(
+		Render::Config const& config
+	)
+	{
+		std::ostringstream settings;
+		settings << "scene cornell" << ( config.f_mirror_block ? " mirror" : " diffuse" ) << "\n"
+			<< "size " << config.image_width << "x" << config.image_height << "\n"
+			<< "depth " << static_cast<int>( config.max_depth ) << "\n"
+			<< "samples " << config.max_samples << "\n"
+			<< "sampler " << ( config.f_sobol ? "sobol" : "philox" ) << " seed " << config.seed << "\n"
+			<< "roulette_depth " << static_cast<int>( config.roulette_depth ) << "\n"
+			<< "light_pool " << config.light_pool_size << "\n"
+			<< "light_samples " << config.light_samples << "\n"
+			<< "integrator " << ( config.f_wavefront ? "wavefront" : "bpt" ) << "\n";
+		return settings.str();
+	};
+
+	// Stored reference of config, rendered first if there is none.
+	// Empty if the stored one was rendered with other settings, or can not be read.
+	std::vector<Colour> reference(
+		Render::Config const& config,
+		std::string const& directory,
+		std::string const& variant,
+		uint16_t const& samples,
+		std::string& file_name
+	)
+	{
+		std::ostringstream name;
+		name << "cornell_" << variant << "_" << config.image_width << "x" << config.image_height << "_depth" << static_cast<int>( config.max_depth ) << "_" << samples << "spp";
+		file_name = ( std::filesystem::path( directory ) / ( name.str() + ".pfm" ) ).string();
+		// Settings and build of the reference, next to it
+		std::string const sidecar_name = ( std::filesystem::path( directory ) / ( name.str() + ".txt" ) ).string();
+
+		Render::Config const reference_config = Bench::reference_config( config, samples );
+		std::string const settings = Bench::reference_settings( reference_config );
+
+		if ( std::filesystem::exists( file_name ) )
+		{
+			std::ifstream sidecar( sidecar_name );
+			std::ostringstream stored;
+			std::string stored_revision;
+			std::string line;
+			while ( std::getline( sidecar, line ) )
+				if ( line.rfind( "revision ", 0 ) == 0 )
+					stored_revision = line.substr( 9 );
+				else
+					stored << line << "\n";
+			if ( stored.str() != settings )
+			{
+				std::cout << "Reference " << file_name << " has no description in " << sidecar_name << ", or was rendered with other settings. Remove it, or use another --reference-dir." << std::endl;
+				return {};
+			}
+			if ( stored_revision != revision )
+				std::cout << "Warning, reference " << file_name << " was rendered by revision " << stored_revision << ", this is " << revision << "." << std::endl;
+
+			std::vector<Colour> pixel = Bench::load_pfm( file_name, config.image_width, config.image_height );
+			if ( pixel.empty() )
+				std::cout << "Could not read reference " << file_name << "." << std::endl;
+			return pixel;
+		}
+
+		std::cout << "Rendering reference " << file_name << "." << std::endl;
+		Render::Scene const scene( reference_config );
+		Render::Image image( scene, reference_config );
+		image.render();
+
+		std::filesystem::create_directories( directory );
+		std::ofstream sidecar( sidecar_name, std::ios::trunc );
+		sidecar << settings << "revision " << revision << "\n";
+		if ( !sidecar || !Bench::save_pfm( file_name, image.pixels(), config.image_width, config.image_height ) )
+			std::cout << "Could not save reference " << file_name << "." << std::endl;
+		return { image.pixels().begin(), image.pixels().end() };
+	};
+
+	// Comma separated list of seconds
+	std::vector<float> parse_times(
+		std::string const& text
+	)
+	{
+		std::vector<float> time;
+		std::istringstream stream( text );
+		std::string item;
+		while ( std::getline( stream, item, ',' ) )
+			if ( float const t = static_cast<float>( std::atof( item.c_str() ) ); t > 0.f )
+				time.push_back( t );
+		return time;
+	};
+
+	bool save_csv(
+		std::string const& file_name,
+		std::vector<Bench::Curve> const& curve
+	)
+	{
+		std::ofstream file( file_name, std::ios::trunc );
+		if ( !file )
+			return false;
+		file << "variant,budget,seconds,passes,rmse,relmse,efficiency\n" << std::setprecision( 6 );
+		for ( Bench::Curve const& c : curve )
+			for ( Bench::Point const& p : c.point )
+				file << c.variant << "," << p.budget << "," << p.seconds << "," << p.passes << "," << p.error.rmse << "," << p.error.relmse << "," << 1. / ( p.error.relmse * p.seconds ) << "\n";
+		return static_cast<bool>( file );
+	};
+
+	bool save_json(
+		std::string const& file_name,
+		std::vector< std::pair<std::string, std::string> > const& context,
+		std::vector<Bench::Curve> const& curve
+	)
+	{
+		std::ofstream file( file_name, std::ios::trunc );
+		if ( !file )
+			return false;
+		file << std::setprecision( 6 ) << "{\n\t\"context\": {";
+		for ( size_t i = 0; i < context.size(); ++i )
+			file << ( i ? ", " : " " ) << "\"" << context[ i ].first << "\": \"" << context[ i ].second << "\"";
+		file << " },\n\t\"curves\": [";
+		for ( size_t i = 0; i < curve.size(); ++i )
+		{
+			file << ( i ? "," : "" ) << "\n\t\t{ \"variant\": \"" << curve[ i ].variant << "\", \"reference\": \"" << curve[ i ].reference << "\", \"points\": [";
+			for ( size_t j = 0; j < curve[ i ].point.size(); ++j )
+			{
+				Bench::Point const& p = curve[ i ].point[ j ];
+				file << ( j ? "," : "" ) << "\n\t\t\t{ \"budget\": " << p.budget << ", \"seconds\": " << p.seconds << ", \"passes\": " << p.passes
+					<< ", \"rmse\": " << p.error.rmse << ", \"relmse\": " << p.error.relmse << ", \"efficiency\": " << 1. / ( p.error.relmse * p.seconds ) << " }";
+			}
+			file << "\n\t\t] }";
+		}
+		file << "\n\t]\n}\n";
+		return static_cast<bool>( file );
+	};
+
+};
+
+int main( int argc, char* argv[] )
+{
+	Render::Config config( 256, 256, 0, 5 );
+	std::vector<float> budget{ 1.f, 2.f, 4.f, 8.f, 16.f };
+	std::vector<std::string> variant{ "diffuse", "mirror" };
+	uint16_t reference_samples{ 1024 };
+	std::string reference_directory{ "reference" };
+	std::string output{ "convergence" };
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		Render::Argument const parsed = Render::parse_argument( argc, argv, i, config );
+		if ( parsed == Render::Argument::invalid )
+			return EXIT_FAILURE;
+		if ( parsed == Render::Argument::used )
+			continue;
+
+		std::string const argument( argv[ i ] );
+		// Comma separated time budgets in seconds
+		if ( ( argument == "--times" ) && ( i + 1 < argc ) )
+			budget = Bench::parse_times( argv[ ++i ] );
+		// Only the diffuse or the mirror tall block
+		else if ( ( argument == "--variant" ) && ( i + 1 < argc ) )
+			variant = { argv[ ++i ] };
+		// Samples per pixel of the references
+		else if ( ( argument == "--reference-samples" ) && ( i + 1 < argc ) )
+			reference_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, 65535 ) );
+		// Where references are stored, and looked for
+		else if ( ( argument == "--reference-dir" ) && ( i + 1 < argc ) )
+			reference_directory = argv[ ++i ];
+		// Results are written to this with .csv and .json appended
+		else if ( ( argument == "--out" ) && ( i + 1 < argc ) )
+			output = argv[ ++i ];
+		// Edge length of the square images
+		else if ( ( argument == "--size" ) && ( i + 1 < argc ) )
+			config.image_width = config.image_height = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 16, 4096 ) );
+		else
+		{
+			std::cout << "Unknown argument " << argument << "." << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if ( budget.empty() )
+	{
+		std::cout << "No time budgets." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Bench::Curve> curve;
+	for ( std::string const& v : variant )
+	{
+		if ( ( v != "diffuse" ) && ( v != "mirror" ) )
+		{
+			std::cout << "Unknown variant " << v << ", use diffuse or mirror." << std::endl;
+			return EXIT_FAILURE;
+		}
+		Render::Config variant_config( config );
+		variant_config.f_mirror_block = v == "mirror";
+
+		Bench::Curve c{ v };
+		std::vector<Colour> const reference = Bench::reference( variant_config, reference_directory, v, reference_samples, c.reference );
+		if ( reference.empty() )
+			return EXIT_FAILURE;
+
+		// Each budget is a fresh render, limited by time only
+		Render::Scene const scene( variant_config );
+		for ( float const t : budget )
+		{
+			variant_config.time_budget = t;
+			std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+			Render::Image image( scene, variant_config );
+			uint32_t const passes = image.render();
+			double const seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+			Bench::Point const p{ t, seconds, passes, Bench::error( image.pixels(), reference ) };
+			c.point.push_back( p );
+			std::cout << std::left << std::setw( 8 ) << v << std::right << std::fixed << std::setprecision( 2 ) << std::setw( 8 ) << seconds << " s" << std::setw( 7 ) << passes << " passes"
+				<< std::scientific << std::setprecision( 3 ) << "  rmse " << p.error.rmse << "  relmse " << p.error.relmse << std::endl;
+		}
+		curve.push_back( c );
+	}
+
+	std::vector< std::pair<std::string, std::string> > const context = { { "integrator", config.f_wavefront ? "wavefront" : "bpt" }, { "sampler", config.f_sobol ? "sobol" : "philox" },
+		{ "light_pool", std::to_string( config.light_pool_size ) }, { "depth", std::to_string( config.max_depth ) }, { "roulette_depth", std::to_string( config.roulette_depth ) },
+		{ "size", std::to_string( config.image_width ) + "x" + std::to_string( config.image_height ) }, { "isa", Dispatch::name( config.isa ) },
+		{ "threads", std::to_string( omp_get_max_threads() ) }, { "reference_samples", std::to_string( reference_samples ) }, { "revision", Bench::revision } };
+	if ( !Bench::save_csv( output + ".csv", curve ) || !Bench::save_json( output + ".json", context, curve ) )
+	{
+		std::cout << "Could not write " << output << ".csv/.json." << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Results written to " << output << ".csv and " << output << ".json." << std::endl;
+	return EXIT_SUCCESS;
+};
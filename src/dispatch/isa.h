@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Target options of the instruction set variants, keep in sync with the pragmas in dispatch/kernel.h
+#define TARGET_AVX2 __attribute__( ( target( "avx2,fma" ) ) )
+#define TARGET_AVX512 __attribute__( ( target( "avx512f,avx512vl,avx512dq,avx2,fma" ) ) )
+
+// Inline into the instruction set variant that calls it, so it is compiled with the same target options
+#define FORCE_INLINE inline __attribute__( ( always_inline ) )
+
+namespace Dispatch
+{
+
+	// Instruction set variants of the hot kernels, from least to most capable
+	enum class ISA : uint8_t
+	{
+		SSE2,
+		AVX2,
+		AVX512
+	};
+
+	inline bool supported(
+		Dispatch::ISA const& isa
+	)
+	{
+		__builtin_cpu_init();
+		switch ( isa )
+		{
+		case Dispatch::ISA::AVX512:
+			return __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512vl" ) && __builtin_cpu_supports( "avx512dq" ) &&
+				__builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+		case Dispatch::ISA::AVX2:
+			return __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+		default:
+			// Part of x86-64
+			return true;
+		}
+	};
+
+	// Best variant the processor supports, from cpuid on the first call only
+	inline Dispatch::ISA detect()
+	{
+		static Dispatch::ISA const isa = []()
+			{
+				if ( supported( Dispatch::ISA::AVX512 ) )
+					return Dispatch::ISA::AVX512;
+				if ( supported( Dispatch::ISA::AVX2 ) )
+					return Dispatch::ISA::AVX2;
+				return Dispatch::ISA::SSE2;
+			}();
+		return isa;
+	};
+
+	inline std::string name(
+		Dispatch::ISA const& isa
+	)
+	{
+		switch ( isa )
+		{
+		case Dispatch::ISA::AVX512:
+			return "avx512";
+		case Dispatch::ISA::AVX2:
+			return "avx2";
+		default:
+			return "sse2";
+		}
+	};
+
+	inline std::optional<Dispatch::ISA> parse(
+		std::string const& text
+	)
+	{
+		for ( Dispatch::ISA const isa : { Dispatch::ISA::SSE2, Dispatch::ISA::AVX2, Dispatch::ISA::AVX512 } )
+			if ( text == name( isa ) )
+				return isa;
+		return std::nullopt;
+	};
+
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+// Hot kernels, compiled once per instruction set.
+// The build targets baseline x86-64, the AVX variants are only called when
+// Dispatch::supported says the processor can run them.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+#include <limits>
+#include <tuple>
+
+#include "../accelerator/depth.h"
+#include "../accelerator/wide_node.h"
+#include "../dispatch/isa.h"
+#include "../mathematics/vec3.h"
+#include "../ray/section.h"
+#include "../ray/segment.h"
+#include "../stats/counters.h"
+
+namespace Kernel::SSE2
+{
+#include "../accelerator/wide_kernel.h"
+};
+
+#define BPT_KERNEL_AVX
+
+#pragma GCC push_options
+#pragma GCC target( "avx2,fma" )
+namespace Kernel::AVX2
+{
+#include "../accelerator/wide_kernel.h"
+};
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target( "avx512f,avx512vl,avx512dq,avx2,fma" )
+namespace Kernel::AVX512
+{
+#include "../accelerator/wide_kernel.h"
+};
+#pragma GCC pop_options
+
+#undef BPT_KERNEL_AVX
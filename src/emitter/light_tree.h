@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <tuple>
+#include <vector>
+
+#include "../emitter/polymorphic.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+
+namespace Emitter
+{
+
+	// Binary hierarchy over the emitters of a scene, each node bounds the position, orientation and power below it.
+	// Traversal picks one emitter, descending into each child in proportion to an estimate of how much it lights a point.
+	// Importance sampling of many lights with adaptive tree splitting, 2018
+	// Alejandro Conty Estevez, Christopher Kulla
+	class LightTree final
+	{
+
+	private:
+
+		// Stored depth first, the first child of an inner node directly follows its parent
+		struct Node
+		{
+			Emitter::Bound bound;
+			// Inner node: index of second child, leaf: index of the emitter
+			uint32_t offset{ 0 };
+			// Root is its own parent
+			uint32_t parent{ 0 };
+			bool f_leaf{ false };
+		};
+
+		std::vector<Node> node;
+		// Leaf node of each emitter
+		std::vector<uint32_t> leaf;
+
+		// Used during build only
+		struct Reference
+		{
+			Emitter::Bound bound;
+			Real3 centre;
+			uint32_t id{ 0 };
+		};
+
+	public:
+
+		LightTree() {};
+
+		LightTree(
+			std::vector< std::shared_ptr<Emitter::Polymorphic> > const& emitter
+		)
+		{
+			if ( emitter.empty() )
+				return;
+
+			std::vector<Reference> reference;
+			reference.reserve( emitter.size() );
+			for ( uint32_t i = 0; i < emitter.size(); ++i )
+			{
+				Emitter::Bound const bound = emitter[ i ]->bound();
+				reference.push_back( { bound, bound.box.centre(), i } );
+			}
+
+			node.reserve( 2 * emitter.size() );
+			leaf.resize( emitter.size() );
+			build( reference, 0, static_cast<uint32_t>( reference.size() ) );
+		};
+
+		// Emitter to connect point to, and the probability it was picked with, zero if no emitter can light the point
+		std::tuple<uint32_t, float> sample(
+			Real3 const& point,
+			Real3 const& normal,
+			float u
+		) const
+		{
+			if ( node.empty() || ( importance( node[ 0 ].bound, point, normal ) <= 0. ) )
+				return { 0, 0.f };
+
+			float pdf{ 1.f };
+			uint32_t current{ 0 };
+			while ( !node[ current ].f_leaf )
+			{
+				uint32_t const first = current + 1;
+				uint32_t const second = node[ current ].offset;
+				Real const i_first = importance( node[ first ].bound, point, normal );
+				Real const i_second = importance( node[ second ].bound, point, normal );
+				if ( i_first + i_second <= 0. )
+					return { 0, 0.f };
+
+				// Reuse u for the next level, rescaled to [0, 1[
+				float const p_first = static_cast<float>( i_first / ( i_first + i_second ) );
+				if ( u < p_first )
+				{
+					u = std::min( u / p_first, 0.99999994f );
+					pdf *= p_first;
+					current = first;
+				}
+				else
+				{
+					u = std::min( ( u - p_first ) / ( 1.f - p_first ), 0.99999994f );
+					pdf *= 1.f - p_first;
+					current = second;
+				}
+			}
+			return { node[ current ].offset, pdf };
+		};
+
+		// Probability that sample picks emitter id for point, the product of the choices on the way up from its leaf
+		float pdf(
+			Real3 const& point,
+			Real3 const& normal,
+			uint32_t const& id
+		) const
+		{
+			if ( node.empty() || ( id >= leaf.size() ) || ( importance( node[ 0 ].bound, point, normal ) <= 0. ) )
+				return 0.f;
+
+			float pdf{ 1.f };
+			for ( uint32_t current = leaf[ id ]; current != 0; current = node[ current ].parent )
+			{
+				uint32_t const parent = node[ current ].parent;
+				Real const i_first = importance( node[ parent + 1 ].bound, point, normal );
+				Real const i_second = importance( node[ node[ parent ].offset ].bound, point, normal );
+				if ( i_first + i_second <= 0. )
+					return 0.f;
+
+				// Same rounding as sample
+				float const p_first = static_cast<float>( i_first / ( i_first + i_second ) );
+				pdf *= current == parent + 1 ? p_first : 1.f - p_first;
+			}
+			return pdf;
+		};
+
+		bool empty() const { return node.empty(); };
+
+	private:
+
+		// cos( max( 0, a - b ) ) and sin( max( 0, a - b ) ), from sines and cosines
+		static Real cos_sub_clamped( Real const sin_a, Real const cos_a, Real const sin_b, Real const cos_b )
+		{
+			return cos_a > cos_b ? 1 : cos_a * cos_b + sin_a * sin_b;
+		};
+
+		static Real sin_sub_clamped( Real const sin_a, Real const cos_a, Real const sin_b, Real const cos_b )
+		{
+			return cos_a > cos_b ? 0 : sin_a * cos_b - cos_a * sin_b;
+		};
+
+		static Real sin_from_cos( Real const cos ) { return std::sqrt( std::max<Real>( 0, 1 - cos * cos ) ); };
+
+		// Upper estimate of the light from the bound reaching point, on a surface facing normal.
+		// Power over squared distance, times the smallest angles the bound allows at the emitter and at the receiver.
+		static Real importance(
+			Emitter::Bound const& bound,
+			Real3 const& point,
+			Real3 const& normal
+		)
+		{
+			Real3 const centre = bound.box.centre();
+			Real const radius_square = bound.box.extent().dot( bound.box.extent() ) * 0.25;
+			Real3 const diff = point - centre;
+			Real const distance_square = diff.dot( diff );
+			// Inside the bounding sphere any direction is possible, and the distance is not trusted
+			if ( distance_square <= radius_square )
+				return bound.power / std::max<Real>( radius_square, 1e-12 );
+
+			Real3 const w = diff / std::sqrt( distance_square );
+
+			// Half angle the bounding sphere subtends from point
+			Real const sin_b = std::sqrt( radius_square / distance_square );
+			Real const cos_b = sin_from_cos( sin_b );
+
+			// Emitter side, angle between the cone and the direction to point, less the spread and the bound
+			Real const cos_w = bound.axis.dot( w );
+			Real const cos_o = bound.cos_spread;
+			Real const sin_o = sin_from_cos( cos_o );
+			Real const cos_x = cos_sub_clamped( sin_from_cos( cos_w ), cos_w, sin_o, cos_o );
+			Real const sin_x = sin_sub_clamped( sin_from_cos( cos_w ), cos_w, sin_o, cos_o );
+			Real const cos_emitter = cos_sub_clamped( sin_x, cos_x, sin_b, cos_b );
+			if ( cos_emitter <= 0. )
+				return 0;
+
+			// Receiver side, one sided as the surfaces only reflect towards their normal
+			Real const cos_i = -normal.dot( w );
+			Real const cos_receiver = cos_sub_clamped( sin_from_cos( cos_i ), cos_i, sin_b, cos_b );
+			if ( cos_receiver <= 0. )
+				return 0;
+
+			return bound.power * cos_emitter * cos_receiver / distance_square;
+		};
+
+		// Smallest cone that holds both cones
+		static std::tuple<Real3, Real> cone_union(
+			Real3 a,
+			Real cos_a,
+			Real3 b,
+			Real cos_b
+		)
+		{
+			// Make a the wider one
+			if ( cos_b < cos_a )
+			{
+				std::swap( a, b );
+				std::swap( cos_a, cos_b );
+			}
+			Real const theta_a = std::acos( std::clamp<Real>( cos_a, -1, 1 ) );
+			Real const theta_b = std::acos( std::clamp<Real>( cos_b, -1, 1 ) );
+			Real const theta_d = std::acos( std::clamp<Real>( a.dot( b ), -1, 1 ) );
+			if ( std::min<Real>( theta_d + theta_b, std::numbers::pi ) <= theta_a )
+				return { a, cos_a };
+
+			Real const theta_o = ( theta_a + theta_d + theta_b ) * 0.5;
+			Real3 const k = a.cross( b );
+			if ( ( theta_o >= std::numbers::pi ) || ( k.magnitude() <= 0. ) )
+				return { a, -1 };
+
+			// Rotate a towards b, by what the new spread adds on its side
+			Real const theta_r = theta_o - theta_a;
+			Real3 const axis = a * std::cos( theta_r ) + k.normalise().cross( a ) * std::sin( theta_r );
+			return { axis.normalise(), std::cos( theta_o ) };
+		};
+
+		// Recursively build the subtree for reference[ first, last [, returns index of its root node
+		uint32_t build(
+			std::vector<Reference>& reference,
+			uint32_t const first,
+			uint32_t const last
+		)
+		{
+			uint32_t const node_id = static_cast<uint32_t>( node.size() );
+			node.emplace_back();
+
+			if ( last - first == 1 )
+			{
+				node[ node_id ].bound = reference[ first ].bound;
+				node[ node_id ].offset = reference[ first ].id;
+				node[ node_id ].f_leaf = true;
+				leaf[ reference[ first ].id ] = node_id;
+				return node_id;
+			}
+
+			// Median split along the longest axis of the centres
+			AABB centre_bound;
+			for ( uint32_t i = first; i < last; ++i )
+				centre_bound = centre_bound + reference[ i ].centre;
+			uint8_t const axis = centre_bound.longest_axis();
+			uint32_t const split = first + ( last - first ) / 2;
+			std::nth_element( &reference[ first ], &reference[ split ], &reference[ 0 ] + last,
+				[ axis ]( Reference const& a, Reference const& b ) { return a.centre[ axis ] < b.centre[ axis ]; } );
+
+			build( reference, first, split );
+			uint32_t const second = build( reference, split, last );
+
+			Emitter::Bound const& b0 = node[ node_id + 1 ].bound;
+			Emitter::Bound const& b1 = node[ second ].bound;
+			auto const [cone_axis, cos_spread] = cone_union( b0.axis, b0.cos_spread, b1.axis, b1.cos_spread );
+			node[ node_id ].bound = { b0.box + b1.box, cone_axis, cos_spread, b0.power + b1.power };
+			node[ node_id ].offset = second;
+			node[ node_id + 1 ].parent = node_id;
+			node[ second ].parent = node_id;
+			return node_id;
+		};
+
+	};
+
+};
@@ -4,22 +4,52 @@
 #include <utility>
 
 #include "../colour/colour.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 
 namespace Emitter
 {
 
+	// Where an emitter is, which way it faces and how much it emits, for building a light tree
+	struct Bound
+	{
+		AABB box;
+		// Surface normals lie within acos( cos_spread ) of axis, emission within a further half sphere
+		Real3 axis{ Real3::Z };
+		Real cos_spread{ 1 };
+		Real power{ 0 };
+	};
+
 	class Polymorphic
 	{
 
 	public:
 
 		// Energy, Point on surface, Direction from surface, Normal at point on surface
-		virtual std::tuple <Colour, Double3, Double3, Double3> emit(
+		// Energy is radiance times area, the point is uniform on the surface, the direction is pdf_direction distributed
+		virtual std::tuple <Colour, Real3, Real3, Real3> emit(
+			Random::Polymorphic& random
+		) const = 0;
+
+		// Energy, Point on surface, Normal at point on surface, without a direction, e.g. for a shadow ray
+		virtual std::tuple <Colour, Real3, Real3> sample(
 			Random::Polymorphic& random
 		) const = 0;
 
+		// Area pdf of the points emit and sample return
+		virtual float pdf_area() const = 0;
+
+		// Solid angle pdf of emit returning direction
+		virtual float pdf_direction(
+			Real3 const& direction
+		) const = 0;
+
+		virtual Emitter::Bound bound() const = 0;
+
+		// Total emitted power, as luminance, used to pick emitters in proportion to it
+		virtual Real power() const = 0;
+
 	};
 
 };
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <tuple>
 #include <utility>
 
 #include "../colour/colour.h"
 #include "../emitter/polymorphic.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/constant.h"
 #include "../mathematics/orthogonal.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../sample/hemisphere.h"
 
@@ -19,36 +23,49 @@ namespace Emitter
 
 	private:
 
-		Double3 position; // a
-		Double3 edge1; // b-a
-		Double3 edge2; // c-a
-		Double3 normal; // edge1 cross edge2
+		Real3 position; // a
+		Real3 edge1; // b-a
+		Real3 edge2; // c-a
+		Real3 normal; // edge1 cross edge2
 
 		Orthogonal local_space;
 
 		Colour energy;
 
-		double area;
+		Real area;
+
+		// Bound on the rounding of sampled points
+		Real error;
 
 	public:
 
 		Triangle() = delete;
 
 		Triangle(
-			Double3 const& a,
-			Double3 const& b,
-			Double3 const& c,
+			Real3 const& a,
+			Real3 const& b,
+			Real3 const& c,
 			Colour const& energy
 		) :
 			position( a ), edge1( b - a ), edge2( c - a ), energy( energy )
 		{
-			Double3 const cross_product = edge1.cross( edge2 );
+			Real3 const cross_product = edge1.cross( edge2 );
 			normal = ( cross_product ).normalise();
 			local_space = Orthogonal( normal );
 			area = .5 * ( cross_product ).magnitude();
+			error = rounding_bound( 8 ) * ( position.abs() + edge1.abs() + edge2.abs() ).magnitude();
+		};
+
+		std::tuple <Colour, Real3, Real3, Real3> emit(
+			Random::Polymorphic& random
+		) const override
+		{
+			auto const [power, point, point_normal] = sample( random );
+			Real3 direction = Sample::CosineHemiSphere( random );
+			return { power, point, local_space.to_world( direction.normalise() ), point_normal };
 		};
 
-		std::tuple <Colour, Double3, Double3, Double3> emit(
+		std::tuple <Colour, Real3, Real3> sample(
 			Random::Polymorphic& random
 		) const override
 		{
@@ -57,9 +74,34 @@ namespace Emitter
 			float const e1_sqrt = std::sqrt( e1 );
 			float const u = e2 * e1_sqrt;
 			float const v = ( 1.f - e2 ) * e1_sqrt;
-			Double3 point = position + edge1 * u + edge2 * v;
-			Double3 direction = Sample::HemiSphere( random );
-			return { energy * area, point, local_space.to_world( direction.normalise() ), normal };
+			// Off the surface by the rounding bound, so emitted and shadow rays do not hit the emitter itself
+			Real3 point = position + edge1 * u + edge2 * v + normal * error;
+			return { energy * area, point, normal };
+		};
+
+		float pdf_area() const override
+		{
+			return static_cast<float>( 1. / area );
+		};
+
+		// Cosine weighted, as for a Lambert emitter
+		float pdf_direction(
+			Real3 const& direction
+		) const override
+		{
+			return std::max( 0.f, static_cast<float>( direction.dot( normal ) ) ) * inv_pi;
+		};
+
+		Emitter::Bound bound() const override
+		{
+			AABB box( position, position + edge1 );
+			box = box + ( position + edge2 );
+			return { box, normal, 1, power() };
+		};
+
+		Real power() const override
+		{
+			return energy.luminance() * area;
 		};
 
 	};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../geometry/triangle.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/orthogonal.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+#include "../memory/aligned_allocator.h"
+#include "../ray/intersection.h"
+#include "../ray/section.h"
+
+namespace Geometry
+{
+
+	// Shading data of a triangle, only read once the closest hit is known
+	struct Shading
+	{
+		// Normal is the z axis
+		Orthogonal orthogonal;
+		uint32_t material_id{ 0 };
+		// |edge1| |edge2| / |edge1 x edge2|, how much the triangle shape magnifies intersection error
+		Real error_scale{ 1 };
+		// Emitter of a face made of light, so a path hitting it can weigh its emission against the emitter's own sampling
+		uint32_t emitter_id{ 0 };
+	};
+
+	// Triangle store of a scene.
+	// Intersection data is packed in one contiguous, cache aligned array, so the
+	// innermost loops stream through memory. Shading data is kept in a second array.
+	class Mesh final
+	{
+
+	private:
+
+		std::vector<Geometry::Triangle, Memory::AlignedAllocator<Geometry::Triangle>> triangle;
+		std::vector<Geometry::Shading> shading;
+
+	public:
+
+		Mesh() {};
+
+		void add(
+			Real3 const& a,
+			Real3 const& b,
+			Real3 const& c,
+			uint32_t const& material_id
+		)
+		{
+			triangle.emplace_back();
+			shading.emplace_back();
+			set( size() - 1, a, b, c, material_id );
+		};
+
+		// Grow, or shrink, to count triangles. New ones are filled in with set, which
+		// is safe to call in parallel for distinct ids, e.g. by a mesh loader.
+		void resize(
+			uint32_t const& count
+		)
+		{
+			triangle.resize( count );
+			shading.resize( count );
+		};
+
+		void set(
+			uint32_t const& id,
+			Real3 const& a,
+			Real3 const& b,
+			Real3 const& c,
+			uint32_t const& material_id
+		)
+		{
+			Geometry::Triangle const t( a, b, c );
+			Real3 const cross_product = t.edge1.cross( t.edge2 );
+			Real const area = cross_product.magnitude();
+			triangle[ id ] = t;
+			// Degenerate triangles are never hit, but keep their shading finite
+			if ( area > 0. )
+				shading[ id ] = { Orthogonal( cross_product / area ), material_id, t.edge1.magnitude() * t.edge2.magnitude() / area };
+			else
+				shading[ id ] = { Orthogonal( Real3::Z ), material_id, 1 };
+		};
+
+		void set_emitter(
+			uint32_t const& id,
+			uint32_t const& emitter_id
+		)
+		{
+			shading[ id ].emitter_id = emitter_id;
+		};
+
+		// Replace all triangles, e.g. with ones already in leaf order from a scene cache
+		void assign(
+			std::span<Geometry::Triangle const> const& triangle_data,
+			std::span<Geometry::Shading const> const& shading_data
+		)
+		{
+			triangle.assign( triangle_data.begin(), triangle_data.end() );
+			shading.assign( shading_data.begin(), shading_data.end() );
+		};
+
+		// Reorder triangles, e.g. into the leaf order of an acceleration structure
+		// order[ i ] is the current index of the triangle that is moved to i
+		void reorder(
+			std::vector<uint32_t> const& order
+		)
+		{
+			decltype( triangle ) ordered_triangle;
+			decltype( shading ) ordered_shading;
+			ordered_triangle.reserve( order.size() );
+			ordered_shading.reserve( order.size() );
+			for ( uint32_t const i : order )
+			{
+				ordered_triangle.push_back( triangle[ i ] );
+				ordered_shading.push_back( shading[ i ] );
+			}
+			triangle.swap( ordered_triangle );
+			shading.swap( ordered_shading );
+		};
+
+		Ray::Intersection post_intersect(
+			Ray::Section const& ray,
+			Real const& distance,
+			uint32_t const& id
+		) const
+		{
+			Geometry::Shading const& s = shading[ id ];
+
+			Ray::Intersection idata;
+			idata.point = ray.origin + ray.direction * distance;
+			idata.normal = s.orthogonal.normal();
+			idata.orthogonal = s.orthogonal;
+			idata.local_wray = idata.orthogonal.to_local( -ray.direction );
+			idata.material_id = s.material_id;
+			idata.emitter_id = s.emitter_id;
+
+			// Moller-Trumbore rounds the distance in proportion to the determinant, which also scales the
+			// normal component of the direction, so the error off the plane does not grow at grazing angles.
+			// Then origin + direction * distance adds its own rounding.
+			Real const origin_distance = ( ray.origin - triangle[ id ].position ).magnitude();
+			idata.error = rounding_bound( 16 ) * ( ( origin_distance + distance ) * s.error_scale + ray.origin.magnitude() + distance );
+
+			return idata;
+		};
+
+		Geometry::Triangle const& operator [] ( uint32_t const& id ) const { return triangle[ id ]; };
+
+		Geometry::Triangle const* data() const { return triangle.data(); };
+
+		std::span<Geometry::Triangle const> triangles() const { return triangle; };
+		std::span<Geometry::Shading const> shadings() const { return shading; };
+
+		uint32_t size() const { return static_cast<uint32_t>( triangle.size() ); };
+
+	};
+
+};
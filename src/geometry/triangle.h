@@ -1,78 +1,62 @@
 #pragma once
 
-#include <cstdint>
 #include <cstdlib>
 
-#include "../geometry/polymorphic.h"
-#include "../mathematics/double3.h"
-#include "../mathematics/orthogonal.h"
-#include "../ray/intersection.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/vec3.h"
 #include "../ray/section.h"
 
 namespace Geometry
 {
 
-	class Triangle final : public Geometry::Polymorphic
+	// Intersection data of a triangle, shading data is kept apart in Geometry::Mesh
+	struct Triangle
 	{
+		Real3 position; // a
+		Real3 edge1; // b-a
+		Real3 edge2; // c-a
 
-	private:
-
-		Double3 position; // a
-		Double3 edge1; // b-a
-		Double3 edge2; // c-a
-		Double3 normal; // edge1 cross edge2
-
-		Orthogonal orthogonal;
-
-		uint32_t material_id;
-
-	public:
-
-		Triangle() = delete;
+		Triangle() {};
 
 		Triangle(
-			Double3 const& a,
-			Double3 const& b,
-			Double3 const& c,
-			uint32_t const& material_id
+			Real3 const& a,
+			Real3 const& b,
+			Real3 const& c
 		) :
-			position( a ), edge1( b - a ), edge2( c - a ), material_id( material_id )
-		{
-			normal = ( edge1.cross( edge2 ) ).normalise();
-			orthogonal = Orthogonal( normal );
-		};
+			position( a ), edge1( b - a ), edge2( c - a )
+		{};
 
-		double intersect(
+		Real intersect(
 			Ray::Section const& ray
-		) const override
+		) const
 		{
-			// Mller-Trumbore intersection algorithm
+			// Moller-Trumbore intersection algorithm
 			// Fast, minimum storage ray/triangle intersection, 1997
 
 			// Calculating determinant
-			Double3 const p = ray.direction.cross( edge2 );
-			double const d = edge1.dot( p );
+			Real3 const p = ray.direction.cross( edge2 );
+			Real const d = edge1.dot( p );
 
 			// If determinant is near zero, ray lies in plane of triangle
 			if ( std::abs( d ) < 0.000001 )
 				return -1.0;
 
-			double const inv_d = 1.0 / d;
+			Real const inv_d = 1.0 / d;
 
-			Double3 const diff = ray.origin - position;
+			Real3 const diff = ray.origin - position;
 
 			// Calculate u parameter and test bound
-			double const u = diff.dot( p ) * inv_d;
+			Real const u = diff.dot( p ) * inv_d;
 			if ( ( u < 0. ) || ( u > 1. ) )
 				return -2.0;
 
 			// Calculate v parameter and test bound
-			Double3 const q = diff.cross( edge1 );
-			double const v = ray.direction.dot( q ) * inv_d;
+			Real3 const q = diff.cross( edge1 );
+			Real const v = ray.direction.dot( q ) * inv_d;
 			if ( ( v < 0. ) || ( u + v > 1. ) )
 				return -3.0;
 
-			double const t = q.dot( edge2 ) * inv_d;
+			Real const t = q.dot( edge2 ) * inv_d;
 
 			if ( t < 0.000001 )
 				return -4.0;
@@ -80,20 +64,10 @@ namespace Geometry
 			return t;
 		};
 
-		Ray::Intersection post_intersect(
-			Ray::Section const& ray,
-			double const& distance
-		) const override
+		AABB bound() const
 		{
-			Ray::Intersection idata;
-			idata.point = ray.origin + ray.direction * distance;
-			idata.normal = normal;
-			idata.orthogonal = orthogonal;
-			idata.local_wray = idata.orthogonal.to_local( -ray.direction );
-			idata.material_id = material_id;
-
-			return idata;
-		}
+			return AABB( position, position + edge1 ) + ( position + edge2 );
+		};
 
 	};
 
@@ -17,22 +17,34 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <span>
+#include <tuple>
 #include <type_traits>
 #include <vector>
 
 #include "../bxdf/common.h"
 #include "../bxdf/polymorphic.h"
 #include "../colour/colour.h"
+#include "../dispatch/isa.h"
+#include "../emitter/polymorphic.h"
 #include "../epsilon.h"
+#include "../integrator/connect.h"
+#include "../integrator/light_pool.h"
+#include "../integrator/mis.h"
 #include "../integrator/polymorphic.h"
+#include "../integrator/roulette.h"
 #include "../integrator/vertex.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 #include "../ray/section.h"
+#include "../ray/segment.h"
 #include "../render/config.h"
 #include "../render/scene.h"
+#include "../stats/counters.h"
 
 namespace Integrator
 {
@@ -49,166 +61,392 @@ namespace Integrator
 
 #pragma warning ( suppress: 4244 )
 		uint8_t const max_depth{ 1 };
-		uint16_t const max_samples{ 1 };
+		uint8_t const roulette_depth{ 1 };
+
+		// Instruction set variant of process
+		Dispatch::ISA const isa{ Dispatch::ISA::SSE2 };
 
 		Render::Scene scene;
 
+		// Light subpaths shared by all threads, null to trace one subpath per camera path
+		std::shared_ptr<Integrator::LightPool> light_pool{ nullptr };
+		// Pool entries each camera path connects to
+		uint8_t const pool_connections{ 1 };
+		// Passes the pool has been filled for, the sample index of its entries
+		uint32_t pool_pass{ 0 };
+		// Subpath of the current sample, when not using the pool
+		// Reused for every sample, with capacity for the longest subpath, so tracing does not allocate
+		mutable Integrator::LightPool::Chunk own_subpath;
+
 	public:
 
 		BPT(
 			Render::Scene const& scene,
 			Render::Config const& config,
-			std::unique_ptr<Random::Polymorphic>& p_random
-
+			std::unique_ptr<Random::Polymorphic>& p_random,
+			std::shared_ptr<Integrator::LightPool> const& light_pool = nullptr
 		)
-			: scene( scene ), p_random( std::move( p_random ) ), max_depth( config.max_depth ), max_samples( config.max_samples )
-		{};
+			: scene( scene ), p_random( std::move( p_random ) ), max_depth( config.max_depth ), roulette_depth( config.roulette_depth ), isa( config.isa ), light_pool( light_pool ),
+			pool_connections( std::clamp<uint8_t>( config.light_pool_connections, 1, max_pool_connections ) )
+		{
+			own_subpath.reserve( 1, scene.n_light_samples(), max_depth );
+		};
+
+		// Trace this thread's share of the light pool
+		void prepare_pass(
+			uint16_t const& thread,
+			uint16_t const& n_thread
+		) override
+		{
+			if ( !light_pool )
+				return;
+
+			++pool_pass;
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return prepare_avx512( thread, n_thread );
+			case Dispatch::ISA::AVX2:
+				return prepare_avx2( thread, n_thread );
+			default:
+				return fill_pool( thread, n_thread );
+			}
+		};
 
 		Colour process(
 			uint16_t const& x,
-			uint16_t const& y
+			uint16_t const& y,
+			uint16_t const& sample
 		) const override
 		{
-			Colour accumulate( Colour::Black );
-			for ( uint16_t s = 0; s < max_samples; ++s )
+			switch ( isa )
 			{
-				// In the paper light start is part of the light path
-				std::vector<Integrator::Vertex> light_start;
-				std::vector<Integrator::Vertex> light_path;
+			case Dispatch::ISA::AVX512:
+				return process_avx512( x, y, sample );
+			case Dispatch::ISA::AVX2:
+				return process_avx2( x, y, sample );
+			default:
+				return trace( x, y, sample );
+			}
+		};
 
-				for ( uint8_t i = 0; i < scene.n_light(); ++i )
+		void process_batch(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const override
+		{
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return batch_avx512( sample, result );
+			case Dispatch::ISA::AVX2:
+				return batch_avx2( sample, result );
+			default:
+				return trace_batch( sample, result );
+			}
+		};
+
+		static constexpr uint8_t max_pool_connections{ 16 };
+
+	private:
+
+		// Colour and Real3 math is inlined, and compiled with the target options of each variant
+		TARGET_AVX512 Colour process_avx512(
+			uint16_t const& x,
+			uint16_t const& y,
+			uint16_t const& sample
+		) const
+		{
+			return trace( x, y, sample );
+		};
+
+		TARGET_AVX2 Colour process_avx2(
+			uint16_t const& x,
+			uint16_t const& y,
+			uint16_t const& sample
+		) const
+		{
+			return trace( x, y, sample );
+		};
+
+		TARGET_AVX512 void batch_avx512(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			trace_batch( sample, result );
+		};
+
+		TARGET_AVX2 void batch_avx2(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			trace_batch( sample, result );
+		};
+
+		TARGET_AVX512 void prepare_avx512(
+			uint16_t const& thread,
+			uint16_t const& n_thread
+		)
+		{
+			fill_pool( thread, n_thread );
+		};
+
+		TARGET_AVX2 void prepare_avx2(
+			uint16_t const& thread,
+			uint16_t const& n_thread
+		)
+		{
+			fill_pool( thread, n_thread );
+		};
+
+		FORCE_INLINE Colour trace(
+			uint16_t const& x,
+			uint16_t const& y,
+			uint16_t const& sample
+		) const
+		{
+			std::array<Integrator::Subpath, max_pool_connections> subpath;
+			uint8_t const n_subpath = light_subpaths( x, y, sample, subpath );
+
+			p_random->start( Integrator::pixel_id( x, y ), sample );
+			Ray::Section const ray = scene.camera_ray( x, y, *p_random );
+			auto const [f_hit, hit_distance, idata] = scene.intersect( ray );
+			return camera_path( ray, f_hit, hit_distance, idata, std::span<Integrator::Subpath const>( subpath.data(), n_subpath ) );
+		};
+
+		// Camera rays of max_batch samples at a time share the camera position, and are traced as one packet.
+		// Each path then continues on its own from its primary hit, with the numbers it would have had from trace.
+		FORCE_INLINE void trace_batch(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			std::array<Ray::Section, Render::Scene::max_batch> ray;
+			std::array<Real3, Render::Scene::max_batch> direction;
+			std::array<Random::Polymorphic::State, Render::Scene::max_batch> state;
+			std::array<Ray::Intersection, Render::Scene::max_batch> idata;
+			std::array<Real, Render::Scene::max_batch> hit_distance;
+			std::array<Integrator::Subpath, max_pool_connections> subpath;
+
+			for ( size_t first = 0; first < sample.size(); first += Render::Scene::max_batch )
+			{
+				uint8_t const count = static_cast<uint8_t>( std::min<size_t>( sample.size() - first, Render::Scene::max_batch ) );
+				for ( uint8_t r = 0; r < count; ++r )
 				{
-					auto [energy, point, direction, normal] = scene.light( i ).emit( *p_random );
-					light_start.emplace_back( Vertex( point, normal, energy ) );
+					Integrator::Sample const& s = sample[ first + r ];
+					p_random->start( Integrator::pixel_id( s.x, s.y ), s.sample );
+					ray[ r ] = scene.camera_ray( s.x, s.y, *p_random );
+					direction[ r ] = ray[ r ].direction;
+					state[ r ] = p_random->state();
+				}
 
-					auto sub_path = emission_path( Ray::Section( point, direction ), energy * direction.dot( normal ) );
+				// A camera with a lens would give rays of other origins, those are traced one by one
+				uint8_t n_packet{ 0 };
+				while ( ( n_packet < count ) && ( ray[ n_packet ].origin == ray[ 0 ].origin ) )
+					++n_packet;
+				uint64_t f_hit = scene.intersect( ray[ 0 ].origin, direction.data(), n_packet, idata.data(), hit_distance.data() );
+				for ( uint8_t r = n_packet; r < count; ++r )
+				{
+					bool f_ray_hit{ false };
+					std::tie( f_ray_hit, hit_distance[ r ], idata[ r ] ) = scene.intersect( ray[ r ] );
+					if ( f_ray_hit )
+						f_hit |= 1ull << r;
+				}
 
-					if ( sub_path.size() > 0 )
-						light_path.insert( std::end( light_path ), std::begin( sub_path ), std::end( sub_path ) );
+				for ( uint8_t r = 0; r < count; ++r )
+				{
+					Integrator::Sample const& s = sample[ first + r ];
+					uint8_t const n_subpath = light_subpaths( s.x, s.y, s.sample, subpath );
+					p_random->resume( state[ r ] );
+					result[ first + r ] = camera_path( ray[ r ], f_hit & ( 1ull << r ), hit_distance[ r ], idata[ r ], std::span<Integrator::Subpath const>( subpath.data(), n_subpath ) );
 				}
-				Ray::Section ray = scene.camera_ray( x, y, s );
-				accumulate += camera_path( ray, light_start, light_path );
 			}
-			return accumulate / static_cast<float>( max_samples );
 		};
 
-	private:
+		// Light subpaths the camera path of a sample connects to, returns how many
+		FORCE_INLINE uint8_t light_subpaths(
+			uint16_t const& x,
+			uint16_t const& y,
+			uint16_t const& sample,
+			std::array<Integrator::Subpath, max_pool_connections>& subpath
+		) const
+		{
+			uint8_t n_subpath{ 0 };
+
+			p_random->start( Integrator::pixel_id( x, y ), sample, Integrator::light_dimension );
+
+			if ( light_pool )
+			{
+				// Random entries of the pool, shared with other pixels
+				for ( ; n_subpath < pool_connections; ++n_subpath )
+				{
+					uint32_t const k = std::min( static_cast<uint32_t>( p_random->get_float() * light_pool->size() ), light_pool->size() - 1 );
+					subpath[ n_subpath ] = light_pool->entry( k );
+				}
+			}
+			else
+			{
+				own_subpath.clear();
+				light_subpath( own_subpath );
+				subpath[ n_subpath++ ] = own_subpath[ 0 ];
+			}
+			return n_subpath;
+		};
+
+		// Entries of the pool chunks owned by thread
+		FORCE_INLINE void fill_pool(
+			uint16_t const& thread,
+			uint16_t const& n_thread
+		) const
+		{
+			for ( uint16_t c = thread; c < light_pool->n_chunk(); c += n_thread )
+			{
+				Integrator::LightPool::Chunk& chunk = ( *light_pool )[ c ];
+				chunk.clear();
+				chunk.reserve( light_pool->first( c + 1 ) - light_pool->first( c ), scene.n_light_samples(), max_depth );
+				for ( uint32_t k = light_pool->first( c ); k < light_pool->first( c + 1 ); ++k )
+				{
+					p_random->start( k, pool_pass, Integrator::light_dimension );
+					light_subpath( chunk );
+				}
+			}
+		};
+
+		// Adds one entry to chunk, a subpath from each of a fixed number of emitters, picked by power
+		FORCE_INLINE void light_subpath(
+			Integrator::LightPool::Chunk& chunk
+		) const
+		{
+			for ( uint32_t j = 0; j < scene.n_light_samples(); ++j )
+			{
+				auto const [id, weight] = scene.pick_light( j, *p_random );
+				Emitter::Polymorphic const& emitter = scene.light( id );
+				auto [energy, point, direction, normal] = emitter.emit( *p_random );
+				energy = energy * weight;
+				// In the paper light start is part of the light path
+				chunk.add_start( Vertex( point, normal, energy, id ) );
+
+				float const cos_theta = static_cast<float>( direction.dot( normal ) );
+				float const pdf_direction = emitter.pdf_direction( direction );
+				// Tangent to the emitter, zero pdf
+				if ( pdf_direction > 0.f )
+					emission_path( Ray::Section( point, direction ), energy * ( cos_theta / pdf_direction ),
+						Integrator::MIS::emission( cos_theta, scene.start_pdf( id ) * pdf_direction ), id, chunk );
+			}
+			chunk.close();
+		};
 
-		std::vector<Integrator::Vertex> emission_path(
+		// Diffuse vertices are added to the open entry of chunk, up to max_depth - 1 from the emitter,
+		// as camera paths connect to them from at least one vertex of their own. Russian roulette may end it sooner.
+		FORCE_INLINE void emission_path(
 			Ray::Section ray,
-			Colour throughput
+			Colour throughput,
+			Integrator::MIS mis,
+			uint32_t const& emitter_id,
+			Integrator::LightPool::Chunk& chunk
 		) const
 		{
-			std::vector<Integrator::Vertex> light_path;
+			float const reference = throughput.max_component();
 			uint8_t depth{ 0 };
-			while ( 1 )
+			while ( ++depth < max_depth )
 			{
 				auto [f_hit, hit_distance, idata] = scene.intersect( ray );
 				if ( !f_hit )
 					break;
 
-				auto [bxdf_colour, bxdf_direction, bxdf_event] = scene.material( idata.material_id )->sample( idata, *p_random );
+				if ( depth == 1 )
+					mis.direct( scene.direct_pdf( emitter_id, idata.point, idata.normal ) );
+				mis.hit( hit_distance, static_cast<float>( idata.local_wray.z ) );
+
+				BxDF::Polymorphic const& material( *scene.material( idata.material_id ) );
+				auto [bxdf_colour, bxdf_direction, bxdf_event, bxdf_pdf] = material.sample( idata, *p_random );
 
 				if ( ( bxdf_event == BxDF::Event::None ) || ( bxdf_event == BxDF::Event::Emission ) )
 					break;
 
 				if ( ( bxdf_event == BxDF::Event::Diffuse ) )
-					light_path.emplace_back( Integrator::Vertex( idata, throughput ) );
-
-				if ( ++depth >= max_depth )
-					break;
+					chunk.add_path( Integrator::Vertex( idata, throughput, mis, depth ) );
 
 				throughput *= bxdf_colour;
-				ray = Ray::Section( idata.point + idata.normal * 0.01, bxdf_direction );
-			}
+				if ( !Integrator::roulette( throughput, reference, depth, roulette_depth, *p_random ) )
+				{
+					BPT_STAT_PATH( light_length, depth );
+					return;
+				}
 
-			return light_path;
+				mis.scatter( static_cast<float>( bxdf_direction.dot( idata.normal ) ), bxdf_pdf, material.pdf_reverse( bxdf_direction, idata ), bxdf_event != BxDF::Event::Diffuse );
+				ray = Ray::Section( idata.offset( bxdf_direction ), bxdf_direction );
+			}
+			// Vertices scattered from, the last hit was a miss, an emitter or past max_depth - 1
+			BPT_STAT_PATH( light_length, depth - 1 );
 		};
 
-		Colour camera_path(
+		// Connects to every vertex of each subpath, and averages over the subpaths.
+		// Paths have at most max_depth surface vertices, so the last ray is only traced for the emitter it may hit.
+		// Russian roulette may end it sooner. Ray has already been traced, to idata at hit_distance if f_hit.
+		FORCE_INLINE Colour camera_path(
 			Ray::Section ray,
-			std::vector<Integrator::Vertex> const& light_start,
-			std::vector<Integrator::Vertex> const& light_path
+			bool f_hit,
+			Real hit_distance,
+			Ray::Intersection idata,
+			std::span<Integrator::Subpath const> subpath
 		) const
 		{
-			// if last hit was diffuse, don't sample lights
-			bool f_prev_event_dirac = true;
+			float const subpath_weight = 1.f / static_cast<float>( subpath.size() );
+
 			// Accumulated emissions, Cij
 			Colour accumulate( Colour::Black );
 			// State of path colour after each bounce
 			Colour throughput( Colour::White );
+			Integrator::MIS mis;
+			// Shadow ray origin of the last vertex, where an emitter connection would have been made from
+			Real3 previous_point;
+			Real3 previous_normal;
 
 			uint8_t depth{ 0 };
-			while ( 1 )
+			while ( f_hit )
 			{
-				auto [f_hit, hit_distance, idata] = scene.intersect( ray );
-				if ( !f_hit )
-					break;
+				mis.hit( hit_distance, static_cast<float>( idata.local_wray.z ) );
 
 				BxDF::Polymorphic const& material( *scene.material( idata.material_id ) );
 
-				auto [bxdf_colour, bxdf_direction, bxdf_event] = material.sample( idata, *p_random );
+				auto [bxdf_colour, bxdf_direction, bxdf_event, bxdf_pdf] = material.sample( idata, *p_random );
 
 				if ( bxdf_event == BxDF::Event::None )
 					break;
 
 				if ( bxdf_event == BxDF::Event::Emission )
 				{
-					// C00, if depth==0
-					// If prev event was diffuse, an emitter have already been sample
-					if ( f_prev_event_dirac )
-						accumulate += throughput * bxdf_colour;
-					break;
-				}
-
-				f_prev_event_dirac = true;
-				if ( bxdf_event == BxDF::Event::Diffuse )
-				{
-					f_prev_event_dirac = false;
-
-					// C0j, j>0
-					Colour explicit_light{ Colour::Black };
-					for ( uint32_t i = 0; i < light_start.size(); ++i )
-					{
-						Double3 const diff = light_start[ i ].idata.point - idata.point;
-						Double3 const direction = diff.normalise();
-						// Direction is pointing in the "wrong" direction at light_start, hence the minus
-						double const cos_theta = -( direction.dot( light_start[ i ].idata.normal ) );
-						if ( cos_theta > 0. )
-						{
-							double const distance = diff.magnitude();
-							Colour bxdf_eval = material.evaluate( direction, idata );
-
-							if ( !bxdf_eval.is_black() )
-								if ( ( distance > EPSILON_DISTANCE ) && ( !scene.occluded( Ray::Section( idata.point, direction ), distance - EPSILON_DISTANCE ) ) )
-									explicit_light += light_start[ i ].throughput * bxdf_eval * ( cos_theta / ( distance * distance ) );
-						}
-					}
-					accumulate += throughput * explicit_light;
-
-					// Cij, i>0 j>0
-					Colour implicit_light{ Colour::Black };
-					for ( uint32_t i = 0; i < light_path.size(); ++i )
+					// C00, weighted against the emitter connections and light subpaths that make the same path
+					if ( ( depth > 0 ) && !bxdf_colour.is_black() )
 					{
-						Double3 diff = light_path[ i ].idata.point - idata.point;
-						Double3 direction = diff.normalise();
-						double distance = diff.magnitude();
-						if ( ( distance > EPSILON_DISTANCE ) && ( !scene.occluded( Ray::Section( idata.point, direction ), distance - EPSILON_DISTANCE ) ) )
-						{
-							Colour bxdf_eval = material.evaluate( direction, idata );
-							Colour path_eval = scene.material( light_path[ i ].idata.material_id )->evaluate( -direction, light_path[ i ].idata );
-							implicit_light += light_path[ i ].throughput * bxdf_eval * path_eval / ( distance * distance );
-						}
+						float const pdf_direct = scene.direct_pdf( idata.emitter_id, previous_point, previous_normal );
+						float const pdf_emission = scene.start_pdf( idata.emitter_id ) * scene.light( idata.emitter_id ).pdf_direction( -ray.direction );
+						bxdf_colour = bxdf_colour * mis.emitter_weight( pdf_direct, pdf_emission );
 					}
-					accumulate += throughput * implicit_light;
+					accumulate += throughput * bxdf_colour;
+					break;
 				}
 
-				if ( ++depth >= max_depth )
+				if ( depth++ >= max_depth )
 					break;
 
+				if ( bxdf_event == BxDF::Event::Diffuse )
+					accumulate += throughput * Integrator::connect( scene, material, idata, mis, max_depth - depth, subpath, subpath_weight, *p_random );
+
 				throughput *= bxdf_colour;
-				ray = Ray::Section( idata.point + idata.normal * 0.01, bxdf_direction );
+				if ( !Integrator::roulette( throughput, 1.f, depth, roulette_depth, *p_random ) )
+					break;
+
+				mis.scatter( static_cast<float>( bxdf_direction.dot( idata.normal ) ), bxdf_pdf, material.pdf_reverse( bxdf_direction, idata ), bxdf_event != BxDF::Event::Diffuse );
+				previous_point = idata.offset( idata.normal );
+				previous_normal = idata.normal;
+				ray = Ray::Section( idata.offset( bxdf_direction ), bxdf_direction );
+				std::tie( f_hit, hit_distance, idata ) = scene.intersect( ray );
 			}
+			BPT_STAT_PATH( camera_length, std::min( depth, max_depth ) );
 			return accumulate;
 		};
 
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <tuple>
+
+#include "../bxdf/polymorphic.h"
+#include "../colour/colour.h"
+#include "../dispatch/isa.h"
+#include "../epsilon.h"
+#include "../integrator/light_pool.h"
+#include "../integrator/mis.h"
+#include "../integrator/vertex.h"
+#include "../mathematics/vec3.h"
+#include "../random/polymorphic.h"
+#include "../ray/intersection.h"
+#include "../ray/segment.h"
+#include "../render/scene.h"
+#include "../stats/counters.h"
+
+namespace Integrator
+{
+
+	// Light reaching a diffuse camera vertex, through the emitters and every vertex of the light subpaths.
+	// Emitter connections C0j go to the starts of the subpaths, or, when the scene has more emitters than the
+	// starts cover, to emitters the light tree picks for this vertex. Connections to the subpaths are averaged
+	// with subpath_weight, and only made to vertices at most light_depth from their emitter, so no path is longer
+	// than the camera path could have made it. Every connection is weighted against the other strategies for its
+	// path with the partial sums of both subpaths, camera_mis being the camera subpath's at this vertex.
+	// All segments share one batched visibility query per max_batch of them.
+	// Shadow rays run between points offset from both surfaces, on the side Lambert reflects to.
+	FORCE_INLINE Colour connect(
+		Render::Scene const& scene,
+		BxDF::Polymorphic const& material,
+		Ray::Intersection const& idata,
+		Integrator::MIS const& camera_mis,
+		uint8_t const light_depth,
+		std::span<Integrator::Subpath const> subpath,
+		float const subpath_weight,
+		Random::Polymorphic& random
+	)
+	{
+		std::array<Ray::Segment, Render::Scene::max_batch> segment;
+		std::array<Colour, Render::Scene::max_batch> contribution;
+		uint8_t n_segment{ 0 };
+
+		Real3 const origin = idata.offset( idata.normal );
+
+		Colour light{ Colour::Black };
+		auto flush = [ & ]()
+			{
+				uint64_t const f_occluded = scene.occluded( origin, segment.data(), n_segment );
+				BPT_STAT( rejected_occluded, std::popcount( f_occluded ) );
+				for ( uint8_t i = 0; i < n_segment; ++i )
+					if ( !( f_occluded & ( 1ull << i ) ) )
+						light += contribution[ i ];
+				n_segment = 0;
+			};
+
+		// C0j, j>0, to a point on emitter id, power is its emitted energy times area.
+		// Pdf_direct is the area pdf the point was picked with, for this vertex.
+		auto connect_emitter = [ & ]( uint32_t const id, Real3 const& point, Real3 const& normal, Colour const& power, float const weight, float const pdf_direct )
+			{
+				BPT_STAT( connections, 1 );
+				Real3 const diff = point - origin;
+				Real3 const direction = diff.normalise();
+				// Direction is pointing in the "wrong" direction at the light start, hence the minus
+				Real const cos_theta = -( direction.dot( normal ) );
+				if ( cos_theta > 0. )
+				{
+					Real const distance = diff.magnitude();
+					Colour bxdf_eval = material.evaluate( direction, idata );
+
+					if ( !bxdf_eval.is_black() && ( distance > EPSILON_DISTANCE ) )
+					{
+						// Against the camera path hitting the emitter, and the light subpath from it hitting this vertex
+						float const pdf_direct_w = pdf_direct * static_cast<float>( distance * distance / cos_theta );
+						float const pdf_emission_w = scene.start_pdf( id ) * scene.light( id ).pdf_direction( -direction );
+						float const cos_camera = static_cast<float>( direction.dot( idata.normal ) );
+						float const w_light = Integrator::mis( material.pdf( direction, idata ) / pdf_direct_w );
+						float const w_camera = Integrator::mis( pdf_emission_w * cos_camera / ( pdf_direct_w * static_cast<float>( cos_theta ) ) )
+							* ( camera_mis.d_vcm + camera_mis.d_vc * Integrator::mis( material.pdf_reverse( direction, idata ) ) );
+
+						segment[ n_segment ] = { direction, static_cast<Real>( distance - EPSILON_DISTANCE ) };
+						contribution[ n_segment ] = power * bxdf_eval * ( weight * cos_theta / ( distance * distance ) / ( w_light + 1.f + w_camera ) );
+						if ( ++n_segment == Render::Scene::max_batch )
+							flush();
+					}
+					else if ( bxdf_eval.is_black() )
+						BPT_STAT( rejected_black, 1 );
+				}
+				else
+					BPT_STAT( rejected_cosine, 1 );
+			};
+
+		for ( uint16_t i = 0; i < scene.n_tree_samples(); ++i )
+		{
+			auto const [id, weight] = scene.pick_light( origin, idata.normal, random );
+			if ( weight <= 0.f )
+				break;
+			auto const [power, point, normal] = scene.light( id ).sample( random );
+			connect_emitter( id, point, normal, power, weight, scene.light( id ).pdf_area() / weight );
+		}
+
+		for ( Integrator::Subpath const& path : subpath )
+		{
+			if ( scene.n_tree_samples() == 0 )
+				for ( uint32_t i = 0; i < path.start.size(); ++i )
+				{
+					Integrator::Vertex const& start = path.start[ i ];
+					connect_emitter( start.idata.emitter_id, start.idata.point, start.idata.normal, start.throughput, subpath_weight, scene.start_pdf( start.idata.emitter_id ) );
+				}
+
+			// Cij, i>0 j>0
+			for ( Integrator::Vertex const& vertex : path.path )
+			{
+				if ( vertex.depth > light_depth )
+					continue;
+
+				BPT_STAT( connections, 1 );
+				Real3 diff = vertex.idata.offset( vertex.idata.normal ) - origin;
+				Real3 direction = diff.normalise();
+				Real distance = diff.magnitude();
+				if ( distance > EPSILON_DISTANCE )
+				{
+					BxDF::Polymorphic const& path_material = *scene.material( vertex.idata.material_id );
+					Colour bxdf_eval = material.evaluate( direction, idata );
+					Colour path_eval = path_material.evaluate( -direction, vertex.idata );
+					if ( !bxdf_eval.is_black() && !path_eval.is_black() )
+					{
+						// Against extending either subpath to the other's vertex, and everything those could have been connected by
+						float const inv_distance_square = static_cast<float>( 1. / ( distance * distance ) );
+						float const pdf_camera_a = material.pdf( direction, idata ) * static_cast<float>( std::abs( direction.dot( vertex.idata.normal ) ) ) * inv_distance_square;
+						float const pdf_light_a = path_material.pdf( -direction, vertex.idata ) * static_cast<float>( std::abs( direction.dot( idata.normal ) ) ) * inv_distance_square;
+						float const w_light = Integrator::mis( pdf_camera_a )
+							* ( vertex.mis.d_vcm + vertex.mis.d_vc * Integrator::mis( path_material.pdf_reverse( -direction, vertex.idata ) ) );
+						float const w_camera = Integrator::mis( pdf_light_a )
+							* ( camera_mis.d_vcm + camera_mis.d_vc * Integrator::mis( material.pdf_reverse( direction, idata ) ) );
+
+						segment[ n_segment ] = { direction, static_cast<Real>( distance - EPSILON_DISTANCE ) };
+						contribution[ n_segment ] = vertex.throughput * bxdf_eval * path_eval * ( subpath_weight * inv_distance_square / ( w_light + 1.f + w_camera ) );
+						if ( ++n_segment == Render::Scene::max_batch )
+							flush();
+					}
+					else
+						BPT_STAT( rejected_black, 1 );
+				}
+			}
+		}
+
+		if ( n_segment > 0 )
+			flush();
+
+		return light;
+	};
+
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../integrator/vertex.h"
+
+namespace Integrator
+{
+
+	// One light subpath per emitter, the start vertices and the diffuse vertices of their emission paths
+	struct Subpath
+	{
+		std::span<Integrator::Vertex const> start;
+		std::span<Integrator::Vertex const> path;
+	};
+
+	// Light subpaths traced once per pass, and read by every camera path of the pass.
+	// Entries live in flat vertex arrays, split in one chunk per thread, so the pool
+	// is filled in parallel without locks, and is read only while tracing camera paths.
+	class LightPool final
+	{
+
+	public:
+
+		// Consecutive entries, built by one thread
+		class Chunk final
+		{
+
+		private:
+
+			std::vector<Integrator::Vertex> start_vertex;
+			std::vector<Integrator::Vertex> path_vertex;
+			// Entry i is [offset[i], offset[i + 1]) in the vertex arrays
+			std::vector<uint32_t> start_offset{ 0 };
+			std::vector<uint32_t> path_offset{ 0 };
+
+		public:
+
+			Chunk() {};
+
+			void clear()
+			{
+				start_vertex.clear();
+				path_vertex.clear();
+				start_offset.assign( 1, 0 );
+				path_offset.assign( 1, 0 );
+			};
+
+			// Capacity for n_entry entries of n_start subpaths, of at most max_depth vertices each
+			void reserve(
+				uint32_t const& n_entry,
+				uint32_t const& n_start,
+				uint8_t const& max_depth
+			)
+			{
+				start_vertex.reserve( n_entry * n_start );
+				path_vertex.reserve( n_entry * n_start * max_depth );
+				start_offset.reserve( n_entry + 1 );
+				path_offset.reserve( n_entry + 1 );
+			};
+
+			// Vertices are added to the open entry, until close
+			void add_start( Integrator::Vertex const& vertex ) { start_vertex.push_back( vertex ); };
+			void add_path( Integrator::Vertex const& vertex ) { path_vertex.push_back( vertex ); };
+
+			void close()
+			{
+				start_offset.push_back( static_cast<uint32_t>( start_vertex.size() ) );
+				path_offset.push_back( static_cast<uint32_t>( path_vertex.size() ) );
+			};
+
+			Integrator::Subpath operator [] ( uint32_t const& i ) const
+			{
+				return {
+					std::span<Integrator::Vertex const>( start_vertex.data() + start_offset[ i ], start_offset[ i + 1 ] - start_offset[ i ] ),
+					std::span<Integrator::Vertex const>( path_vertex.data() + path_offset[ i ], path_offset[ i + 1 ] - path_offset[ i ] ) };
+			};
+
+			uint32_t size() const { return static_cast<uint32_t>( start_offset.size() - 1 ); };
+
+		};
+
+	private:
+
+		uint32_t n_entry{ 0 };
+		std::vector<Chunk> chunk;
+
+	public:
+
+		LightPool() = delete;
+
+		LightPool(
+			uint32_t const& n_entry,
+			uint16_t const& n_chunk
+		)
+			: n_entry( n_entry ), chunk( std::max<uint16_t>( n_chunk, 1 ) )
+		{};
+
+		// First entry of chunk c, chunk sizes differ by at most one
+		uint32_t first( uint16_t const& c ) const
+		{
+			return static_cast<uint32_t>( static_cast<uint64_t>( n_entry ) * c / chunk.size() );
+		};
+
+		Chunk& operator [] ( uint16_t const& c ) { return chunk[ c ]; };
+
+		// Entry k of the whole pool
+		Integrator::Subpath entry( uint32_t const& k ) const
+		{
+			// Last chunk with first( c ) <= k
+			uint16_t const c = static_cast<uint16_t>( ( ( static_cast<uint64_t>( k ) + 1 ) * chunk.size() - 1 ) / n_entry );
+			return chunk[ c ][ k - first( c ) ];
+		};
+
+		uint32_t size() const { return n_entry; };
+
+		uint16_t n_chunk() const { return static_cast<uint16_t>( chunk.size() ); };
+
+	};
+
+};
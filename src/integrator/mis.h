@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "../dispatch/isa.h"
+#include "../mathematics/real.h"
+
+namespace Integrator
+{
+
+	// Power heuristic, beta = 2
+	FORCE_INLINE float mis( float const x ) { return x * x; };
+
+	// Partial sums of the multiple importance sampling weight of a subpath, updated at every vertex,
+	// so a connection weighs all the ways the joined path could have been sampled in constant time.
+	// Implementing vertex connection and merging, 2012
+	// Iliyan Georgiev
+	// Only the strategies of this integrator are counted: camera paths hitting emitters, emitter connections
+	// and subpath connections. Light paths are not connected to the camera, so camera subpaths start at zero.
+	struct MIS
+	{
+		float d_vcm{ 0.f };
+		float d_vc{ 0.f };
+
+		// Light subpath leaving an emitter at cos_theta to its normal, pdf_emission is the area pdf of the start times the solid angle pdf of the direction.
+		// d_vcm still lacks the area pdf of the emitter connections, which depends on the first vertex, see direct.
+		static MIS emission(
+			float const cos_theta,
+			float const pdf_emission
+		)
+		{
+			return { Integrator::mis( 1.f / pdf_emission ), Integrator::mis( cos_theta / pdf_emission ) };
+		};
+
+		// Area pdf of an emitter connection from the first vertex of a light subpath to its start
+		FORCE_INLINE void direct(
+			float const pdf_direct
+		)
+		{
+			d_vcm *= Integrator::mis( pdf_direct );
+		};
+
+		// Ray of length distance hit a surface, at cos_theta to its normal
+		FORCE_INLINE void hit(
+			Real const distance,
+			float const cos_theta
+		)
+		{
+			// Grazing hits would divide by zero
+			float const cos_mis = Integrator::mis( std::max( std::abs( cos_theta ), 1e-6f ) );
+			d_vcm *= Integrator::mis( static_cast<float>( distance * distance ) ) / cos_mis;
+			d_vc /= cos_mis;
+		};
+
+		// Leaving a surface in a sampled direction, at cos_theta to the normal. Pdf of the direction, and of the reverse.
+		FORCE_INLINE void scatter(
+			float const cos_theta,
+			float const pdf,
+			float const pdf_reverse,
+			bool const f_dirac
+		)
+		{
+			// Dirac pdfs cancel, and no connection can be made to the vertex
+			if ( f_dirac )
+			{
+				d_vcm = 0.f;
+				d_vc *= Integrator::mis( std::abs( cos_theta ) );
+				return;
+			}
+			d_vc = Integrator::mis( std::abs( cos_theta ) / pdf ) * ( d_vc * Integrator::mis( pdf_reverse ) + d_vcm );
+			d_vcm = Integrator::mis( 1.f / pdf );
+		};
+
+		// Camera path hitting an emitter, against the emitter connections (pdf_direct, area) and the light subpaths (pdf_emission, area times solid angle)
+		FORCE_INLINE float emitter_weight(
+			float const pdf_direct,
+			float const pdf_emission
+		) const
+		{
+			return 1.f / ( 1.f + Integrator::mis( pdf_direct ) * d_vcm + Integrator::mis( pdf_emission ) * d_vc );
+		};
+
+	};
+
+};
@@ -1,12 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 #include "../colour/colour.h"
 
 namespace Integrator
 {
 
+	// Sampler dimensions of a sample: its camera path from zero, its light subpaths from light_dimension on,
+	// so the camera path draws the same dimensions, however long the light subpaths are
+	constexpr uint32_t light_dimension{ 1u << 16 };
+
+	// Sampler pixel id of pixel ( x, y )
+	inline uint32_t pixel_id( uint16_t const& x, uint16_t const& y ) { return ( static_cast<uint32_t>( y ) << 16 ) | x; };
+
+	// One sample of pixel ( x, y )
+	struct Sample
+	{
+		uint16_t x{ 0 };
+		uint16_t y{ 0 };
+		uint16_t sample{ 0 };
+	};
+
 	class Polymorphic
 	{
 
@@ -14,9 +30,23 @@ namespace Integrator
 
 		Polymorphic() {};
 
-		virtual Colour process( uint16_t const& x, uint16_t const& y ) const = 0;
+		// Integrators are owned through this base, and hold their buffers and random generator
+		virtual ~Polymorphic() = default;
+
+		// Radiance estimate of one sample of pixel ( x, y )
+		virtual Colour process( uint16_t const& x, uint16_t const& y, uint16_t const& sample ) const = 0;
+
+		// Radiance estimates of a batch of samples, result[ i ] belongs to sample[ i ]
+		// Traces them one by one, stream based integrators process the whole batch stage by stage
+		virtual void process_batch( std::span<Integrator::Sample const> sample, Colour* result ) const
+		{
+			for ( std::size_t i = 0; i < sample.size(); ++i )
+				result[ i ] = process( sample[ i ].x, sample[ i ].y, sample[ i ].sample );
+		};
+
+		// Work shared by all samples of a pass, called by every thread, with its index and the thread count, before the pass is traced
+		virtual void prepare_pass( uint16_t const&, uint16_t const& ) {};
 
 	};
 
 };
-
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../colour/colour.h"
+#include "../dispatch/isa.h"
+#include "../random/polymorphic.h"
+
+namespace Integrator
+{
+
+	// Russian roulette, once a path has min_depth surface vertices.
+	// It continues with the probability that its throughput keeps of reference, the throughput it started with,
+	// and survivors are divided by that probability, so the estimate stays unbiased. Dim paths end early.
+	// False if the path ends.
+	FORCE_INLINE bool roulette(
+		Colour& throughput,
+		float const reference,
+		uint8_t const depth,
+		uint8_t const min_depth,
+		Random::Polymorphic& random
+	)
+	{
+		if ( depth < min_depth )
+			return true;
+
+		float const survive = throughput.max_component() / reference;
+		if ( survive >= 1.f )
+			return true;
+		if ( !( random.get_float() < survive ) )
+			return false;
+
+		throughput = throughput / survive;
+		return true;
+	};
+
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
+
 #include "../colour/colour.h"
-#include "../mathematics/double3.h"
+#include "../integrator/mis.h"
+#include "../mathematics/vec3.h"
 #include "../ray/intersection.h"
 
 namespace Integrator
@@ -13,20 +16,27 @@ namespace Integrator
 
 		Colour throughput;
 
+		// Emission path: weight sums of the subpath up to here, and surface vertices from the emitter, one for the first hit
+		Integrator::MIS mis;
+		uint8_t depth{ 0 };
+
 		Vertex() = default;
 
 		// Emission start
-		Vertex( Double3 const& point, Double3 const& normal, Colour const& throughput ) :
+		Vertex( Real3 const& point, Real3 const& normal, Colour const& throughput, uint32_t const& emitter_id ) :
 			throughput( throughput )
 		{
 			idata.point = point;
 			idata.normal = normal;
+			idata.emitter_id = emitter_id;
 		};
 
 		// Emission path (materials)
-		Vertex( Ray::Intersection const& idata, Colour const& throughput ) :
+		Vertex( Ray::Intersection const& idata, Colour const& throughput, Integrator::MIS const& mis, uint8_t const& depth ) :
 			idata( idata ),
-			throughput( throughput )
+			throughput( throughput ),
+			mis( mis ),
+			depth( depth )
 		{};
 
 	};
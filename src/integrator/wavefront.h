@@ -0,0 +1,523 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "../bxdf/common.h"
+#include "../bxdf/polymorphic.h"
+#include "../colour/colour.h"
+#include "../dispatch/isa.h"
+#include "../emitter/polymorphic.h"
+#include "../integrator/bpt.h"
+#include "../integrator/connect.h"
+#include "../integrator/light_pool.h"
+#include "../integrator/mis.h"
+#include "../integrator/polymorphic.h"
+#include "../integrator/roulette.h"
+#include "../integrator/vertex.h"
+#include "../mathematics/vec3.h"
+#include "../random/polymorphic.h"
+#include "../ray/intersection.h"
+#include "../ray/section.h"
+#include "../render/config.h"
+#include "../render/scene.h"
+#include "../stats/counters.h"
+
+namespace Integrator
+{
+
+	// Bi-directional path tracing as a stream of path states.
+	// Same estimator as Integrator::BPT, but a whole batch of samples advances one stage at a time:
+	// generate, extend (intersect), shade grouped by material, connect (shadow rays), accumulate.
+	// Each stage is one loop over a queue, so its code and data stay in cache.
+	class Wavefront final : public Integrator::Polymorphic
+	{
+
+	private:
+
+		// Light or camera path in flight
+		struct PathState
+		{
+			Ray::Section ray;
+			Colour throughput;
+			// Throughput the path started with, for Russian roulette
+			float reference{ 1.f };
+			// Camera path: sample in the batch, light path: subpath slot
+			uint32_t id{ 0 };
+			uint8_t depth{ 0 };
+			bool f_alive{ true };
+			Integrator::MIS mis;
+			// Sampler the path continues from, paths of a batch are shaded interleaved
+			Random::Polymorphic::State random;
+			// Camera path: shadow ray origin of the last vertex, where an emitter connection would have been made from
+			Real3 previous_point;
+			Real3 previous_normal;
+		};
+
+		// Diffuse camera vertex, waiting for the connect stage
+		struct Connection
+		{
+			// Index of its intersection in hit, which the connect stage reads before the next extend
+			uint32_t hit{ 0 };
+			Colour throughput;
+			uint32_t id{ 0 };
+			Integrator::MIS mis;
+			uint8_t light_depth{ 0 };
+			// Camera vertices up to here
+			uint8_t depth{ 0 };
+		};
+
+		// Sampler dimensions of the emissions of a sample start at light_dimension, one stream as in BPT::light_subpath,
+		// those of the bounces of the light subpath of its j-th emitter at light_dimension + ( j + 1 ) * subpath_dimensions,
+		// and those of the emitter connections at camera vertex depth at connect_dimension + depth * subpath_dimensions
+		static constexpr uint32_t subpath_dimensions{ 1u << 12 };
+		static constexpr uint32_t connect_dimension{ 1u << 24 };
+
+		std::unique_ptr<Random::Polymorphic> p_random{ nullptr };
+
+		uint8_t const max_depth{ 1 };
+		uint8_t const roulette_depth{ 1 };
+
+		// Instruction set variant of process
+		Dispatch::ISA const isa{ Dispatch::ISA::SSE2 };
+
+		Render::Scene scene;
+
+		// Light subpaths shared by all threads, null to trace subpaths per sample
+		std::shared_ptr<Integrator::LightPool> light_pool{ nullptr };
+		uint8_t const pool_connections{ 1 };
+
+		// Stage queues, reused for every batch
+		mutable std::vector<PathState> path;
+		mutable std::vector<Ray::Intersection> hit;
+		mutable std::vector<uint32_t> shade_order;
+		mutable std::vector<uint32_t> material_offset;
+		mutable std::vector<Connection> connection;
+
+		// Light subpaths of the batch, one slot per sample and emitter, with max_depth vertices each
+		mutable std::vector<Integrator::Vertex> light_start;
+		mutable std::vector<Integrator::Vertex> light_vertex;
+		mutable std::vector<uint8_t> light_count;
+		// Subpaths each sample connects to, n_subpath consecutive ones per sample
+		mutable std::vector<Integrator::Subpath> subpath;
+
+		// Passes the pool has been filled for, the sample index of its entries
+		uint32_t pool_pass{ 0 };
+
+	public:
+
+		Wavefront(
+			Render::Scene const& scene,
+			Render::Config const& config,
+			std::unique_ptr<Random::Polymorphic>& p_random,
+			std::shared_ptr<Integrator::LightPool> const& light_pool = nullptr
+		)
+			: p_random( std::move( p_random ) ), max_depth( config.max_depth ), roulette_depth( config.roulette_depth ), isa( config.isa ), scene( scene ), light_pool( light_pool ),
+			pool_connections( std::clamp<uint8_t>( config.light_pool_connections, 1, Integrator::BPT::max_pool_connections ) )
+		{};
+
+		Colour process(
+			uint16_t const& x,
+			uint16_t const& y,
+			uint16_t const& sample
+		) const override
+		{
+			Integrator::Sample const one{ x, y, sample };
+			Colour result;
+			process_batch( std::span<Integrator::Sample const>( &one, 1 ), &result );
+			return result;
+		};
+
+		void process_batch(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const override
+		{
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return process_avx512( sample, result );
+			case Dispatch::ISA::AVX2:
+				return process_avx2( sample, result );
+			default:
+				return trace( sample, result );
+			}
+		};
+
+		// Trace this thread's share of the light pool
+		void prepare_pass(
+			uint16_t const& thread,
+			uint16_t const& n_thread
+		) override
+		{
+			if ( !light_pool )
+				return;
+
+			++pool_pass;
+			for ( uint16_t c = thread; c < light_pool->n_chunk(); c += n_thread )
+			{
+				uint32_t const first = light_pool->first( c );
+				uint32_t const n_entry = light_pool->first( c + 1 ) - first;
+
+				light( n_entry, {}, first );
+
+				Integrator::LightPool::Chunk& chunk = ( *light_pool )[ c ];
+				chunk.clear();
+				chunk.reserve( n_entry, scene.n_light_samples(), max_depth );
+				for ( uint32_t k = 0; k < n_entry; ++k )
+				{
+					for ( uint32_t slot = k * scene.n_light_samples(); slot < ( k + 1 ) * scene.n_light_samples(); ++slot )
+					{
+						chunk.add_start( light_start[ slot ] );
+						for ( uint8_t i = 0; i < light_count[ slot ]; ++i )
+							chunk.add_path( light_vertex[ slot * max_depth + i ] );
+					}
+					chunk.close();
+				}
+			}
+		};
+
+	private:
+
+		// Colour and Real3 math is inlined, and compiled with the target options of each variant
+		TARGET_AVX512 void process_avx512(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			trace( sample, result );
+		};
+
+		TARGET_AVX2 void process_avx2(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			trace( sample, result );
+		};
+
+		// Light subpaths have variants of their own, one function with both stages is too large for the inliner
+		// to take in the small helpers of the path math, which then run as calls to baseline code
+		void light(
+			uint32_t const& n_entry,
+			std::span<Integrator::Sample const> sample,
+			uint32_t const& first_entry = 0
+		) const
+		{
+			switch ( isa )
+			{
+			case Dispatch::ISA::AVX512:
+				return light_avx512( n_entry, sample, first_entry );
+			case Dispatch::ISA::AVX2:
+				return light_avx2( n_entry, sample, first_entry );
+			default:
+				return trace_light( n_entry, sample, first_entry );
+			}
+		};
+
+		TARGET_AVX512 void light_avx512(
+			uint32_t const& n_entry,
+			std::span<Integrator::Sample const> sample,
+			uint32_t const& first_entry
+		) const
+		{
+			trace_light( n_entry, sample, first_entry );
+		};
+
+		TARGET_AVX2 void light_avx2(
+			uint32_t const& n_entry,
+			std::span<Integrator::Sample const> sample,
+			uint32_t const& first_entry
+		) const
+		{
+			trace_light( n_entry, sample, first_entry );
+		};
+
+		FORCE_INLINE void trace(
+			std::span<Integrator::Sample const> sample,
+			Colour* result
+		) const
+		{
+			uint32_t const n_sample = static_cast<uint32_t>( sample.size() );
+
+			// Generate light subpaths, from the pool or one per sample and picked emitter
+			uint32_t n_subpath{ 0 };
+			float subpath_weight{ 1.f };
+			if ( light_pool )
+			{
+				n_subpath = pool_connections;
+				subpath_weight = 1.f / static_cast<float>( n_subpath );
+				subpath.resize( n_sample * n_subpath );
+				for ( uint32_t i = 0; i < n_sample; ++i )
+				{
+					p_random->start( Integrator::pixel_id( sample[ i ].x, sample[ i ].y ), sample[ i ].sample, Integrator::light_dimension );
+					for ( uint32_t j = 0; j < n_subpath; ++j )
+					{
+						uint32_t const k = std::min( static_cast<uint32_t>( p_random->get_float() * light_pool->size() ), light_pool->size() - 1 );
+						subpath[ i * n_subpath + j ] = light_pool->entry( k );
+					}
+				}
+			}
+			else
+			{
+				n_subpath = scene.n_light_samples();
+				light( n_sample, sample );
+				subpath.resize( n_sample * n_subpath );
+				for ( uint32_t slot = 0; slot < subpath.size(); ++slot )
+					subpath[ slot ] = {
+						std::span<Integrator::Vertex const>( &light_start[ slot ], 1 ),
+						std::span<Integrator::Vertex const>( &light_vertex[ slot * max_depth ], light_count[ slot ] ) };
+			}
+
+			// Generate camera paths
+			path.clear();
+			for ( uint32_t i = 0; i < n_sample; ++i )
+			{
+				p_random->start( Integrator::pixel_id( sample[ i ].x, sample[ i ].y ), sample[ i ].sample );
+				// Braced initialisers are evaluated in order, the sampler state is the one after the camera ray
+				path.push_back( { scene.camera_ray( sample[ i ].x, sample[ i ].y, *p_random ), Colour::White, 1.f, i, 0, true, Integrator::MIS(), p_random->state(), Real3(), Real3() } );
+				result[ i ] = Colour::Black;
+			}
+
+			bool f_primary{ true };
+			while ( !path.empty() )
+			{
+				extend( f_primary );
+				f_primary = false;
+
+				// Shade, paths with the same material one after another
+				// Paths have at most max_depth surface vertices, so the last ray is only traced for the emitter it may hit
+				connection.clear();
+				for ( uint32_t const i : shade_order )
+				{
+					PathState& state = path[ i ];
+					Ray::Intersection const& idata = hit[ i ];
+					state.mis.hit( ( idata.point - state.ray.origin ).magnitude(), static_cast<float>( idata.local_wray.z ) );
+
+					p_random->resume( state.random );
+					BxDF::Polymorphic const& material( *scene.material( idata.material_id ) );
+					auto [bxdf_colour, bxdf_direction, bxdf_event, bxdf_pdf] = material.sample( idata, *p_random );
+
+					state.f_alive = false;
+					if ( bxdf_event == BxDF::Event::None )
+						continue;
+
+					if ( bxdf_event == BxDF::Event::Emission )
+					{
+						// C00, weighted against the emitter connections and light subpaths that make the same path
+						if ( ( state.depth > 0 ) && !bxdf_colour.is_black() )
+						{
+							float const pdf_direct = scene.direct_pdf( idata.emitter_id, state.previous_point, state.previous_normal );
+							float const pdf_emission = scene.start_pdf( idata.emitter_id ) * scene.light( idata.emitter_id ).pdf_direction( -state.ray.direction );
+							bxdf_colour = bxdf_colour * state.mis.emitter_weight( pdf_direct, pdf_emission );
+						}
+						result[ state.id ] += state.throughput * bxdf_colour;
+						continue;
+					}
+
+					if ( state.depth++ >= max_depth )
+						continue;
+
+					if ( bxdf_event == BxDF::Event::Diffuse )
+						connection.push_back( { i, state.throughput, state.id, state.mis, static_cast<uint8_t>( max_depth - state.depth ), state.depth } );
+
+					state.throughput *= bxdf_colour;
+					if ( !Integrator::roulette( state.throughput, state.reference, state.depth, roulette_depth, *p_random ) )
+						continue;
+
+					state.random = p_random->state();
+					state.mis.scatter( static_cast<float>( bxdf_direction.dot( idata.normal ) ), bxdf_pdf, material.pdf_reverse( bxdf_direction, idata ), bxdf_event != BxDF::Event::Diffuse );
+					state.previous_point = idata.offset( idata.normal );
+					state.previous_normal = idata.normal;
+					state.ray = Ray::Section( idata.offset( bxdf_direction ), bxdf_direction );
+					state.f_alive = true;
+				}
+
+				// Connect diffuse vertices to the light subpaths of their sample
+				for ( Connection const& vertex : connection )
+				{
+					p_random->start( Integrator::pixel_id( sample[ vertex.id ].x, sample[ vertex.id ].y ), sample[ vertex.id ].sample, connect_dimension + vertex.depth * subpath_dimensions );
+					Ray::Intersection const& idata = hit[ vertex.hit ];
+					result[ vertex.id ] += vertex.throughput * Integrator::connect( scene, *scene.material( idata.material_id ), idata, vertex.mis, vertex.light_depth,
+						std::span<Integrator::Subpath const>( &subpath[ vertex.id * n_subpath ], n_subpath ), subpath_weight, *p_random );
+				}
+
+#ifdef BPT_STATS
+				for ( PathState const& state : path )
+					if ( !state.f_alive )
+						BPT_STAT_PATH( camera_length, std::min( state.depth, max_depth ) );
+#endif
+				std::erase_if( path, []( PathState const& state ) { return !state.f_alive; } );
+			}
+		};
+
+		// Light subpaths of n_entry samples, one per picked emitter, into the light slots.
+		// The samples of a batch, or none for pool entries first_entry on.
+		FORCE_INLINE void trace_light(
+			uint32_t const& n_entry,
+			std::span<Integrator::Sample const> sample,
+			uint32_t const& first_entry = 0
+		) const
+		{
+			uint32_t const n_slot = n_entry * scene.n_light_samples();
+			light_start.resize( n_slot );
+			light_vertex.resize( n_slot * max_depth );
+			light_count.assign( n_slot, 0 );
+
+			// Sampler position of the subpath in slot
+			auto const start = [ & ]( uint32_t const& slot, uint32_t const& dimension )
+				{
+					uint32_t const k = slot / scene.n_light_samples();
+					if ( sample.empty() )
+						p_random->start( first_entry + k, pool_pass, dimension );
+					else
+						p_random->start( Integrator::pixel_id( sample[ k ].x, sample[ k ].y ), sample[ k ].sample, dimension );
+				};
+
+			// Generate
+			path.clear();
+			for ( uint32_t slot = 0; slot < n_slot; ++slot )
+			{
+				if ( slot % scene.n_light_samples() == 0 )
+					start( slot, Integrator::light_dimension );
+				auto const [id, weight] = scene.pick_light( slot % scene.n_light_samples(), *p_random );
+				Emitter::Polymorphic const& emitter = scene.light( id );
+				auto [energy, point, direction, normal] = emitter.emit( *p_random );
+				energy = energy * weight;
+				// In the paper light start is part of the light path
+				light_start[ slot ] = Integrator::Vertex( point, normal, energy, id );
+
+				float const cos_theta = static_cast<float>( direction.dot( normal ) );
+				float const pdf_direction = emitter.pdf_direction( direction );
+				// Camera paths connect to vertices up to max_depth - 1 from the emitter, none leave tangent to the emitter
+				if ( ( max_depth > 1 ) && ( pdf_direction > 0.f ) )
+				{
+					Colour const throughput = energy * ( cos_theta / pdf_direction );
+					path.push_back( { Ray::Section( point, direction ), throughput, throughput.max_component(), slot, 0, true,
+						Integrator::MIS::emission( cos_theta, scene.start_pdf( id ) * pdf_direction ), p_random->state(), Real3(), Real3() } );
+				}
+			}
+
+			while ( !path.empty() )
+			{
+				extend();
+
+				// Shade, only diffuse vertices are stored
+				for ( uint32_t const i : shade_order )
+				{
+					PathState& state = path[ i ];
+					Ray::Intersection const& idata = hit[ i ];
+					if ( state.depth == 0 )
+						state.mis.direct( scene.direct_pdf( light_start[ state.id ].idata.emitter_id, idata.point, idata.normal ) );
+					state.mis.hit( ( idata.point - state.ray.origin ).magnitude(), static_cast<float>( idata.local_wray.z ) );
+
+					BxDF::Polymorphic const& material( *scene.material( idata.material_id ) );
+					if ( state.depth == 0 )
+						start( state.id, Integrator::light_dimension + ( state.id % scene.n_light_samples() + 1 ) * subpath_dimensions );
+					else
+						p_random->resume( state.random );
+					auto [bxdf_colour, bxdf_direction, bxdf_event, bxdf_pdf] = material.sample( idata, *p_random );
+
+					state.f_alive = false;
+					if ( ( bxdf_event == BxDF::Event::None ) || ( bxdf_event == BxDF::Event::Emission ) )
+						continue;
+
+					++state.depth;
+					if ( bxdf_event == BxDF::Event::Diffuse )
+						light_vertex[ state.id * max_depth + light_count[ state.id ]++ ] = Integrator::Vertex( idata, state.throughput, state.mis, state.depth );
+
+					if ( state.depth + 1 >= max_depth )
+						continue;
+
+					state.throughput *= bxdf_colour;
+					if ( !Integrator::roulette( state.throughput, state.reference, state.depth, roulette_depth, *p_random ) )
+						continue;
+					state.random = p_random->state();
+
+					state.mis.scatter( static_cast<float>( bxdf_direction.dot( idata.normal ) ), bxdf_pdf, material.pdf_reverse( bxdf_direction, idata ), bxdf_event != BxDF::Event::Diffuse );
+					state.ray = Ray::Section( idata.offset( bxdf_direction ), bxdf_direction );
+					state.f_alive = true;
+				}
+
+#ifdef BPT_STATS
+				for ( PathState const& state : path )
+					if ( !state.f_alive )
+						BPT_STAT_PATH( light_length, state.depth );
+#endif
+				std::erase_if( path, []( PathState const& state ) { return !state.f_alive; } );
+			}
+		};
+
+		// Intersect every path, and order the hits by material for shading
+		// Paths that leave the scene are marked dead
+		// Primary rays of neighbouring pixels share the camera origin, and are traced as coherent packets
+		// Not forced inline, it has no path math and is the same in every variant
+		void extend(
+			bool const& f_primary = false
+		) const
+		{
+			uint32_t const n_material = scene.n_material();
+			hit.resize( path.size() );
+			material_offset.assign( n_material + 1, 0 );
+
+			auto const add_hit = [ & ]( uint32_t const& i, Ray::Intersection idata )
+				{
+					// Unknown ids shade as material zero, like Scene::material
+					if ( idata.material_id >= n_material )
+						idata.material_id = 0;
+					hit[ i ] = idata;
+					++material_offset[ idata.material_id + 1 ];
+				};
+
+			// Outside the loop, as constructing them zeroes a few kilobytes
+			std::array<Real3, Render::Scene::max_batch> direction;
+			std::array<Ray::Intersection, Render::Scene::max_batch> idata;
+
+			uint32_t i{ 0 };
+			while ( i < path.size() )
+			{
+				// Consecutive rays from the same origin
+				uint8_t count{ 0 };
+				if ( f_primary )
+					while ( ( i + count < path.size() ) && ( count < Render::Scene::max_batch ) && ( path[ i + count ].ray.origin == path[ i ].ray.origin ) )
+					{
+						direction[ count ] = path[ i + count ].ray.direction;
+						++count;
+					}
+
+				if ( count > 1 )
+				{
+					uint64_t const f_hit = scene.intersect( path[ i ].ray.origin, direction.data(), count, idata.data() );
+					for ( uint8_t r = 0; r < count; ++r )
+					{
+						path[ i + r ].f_alive = f_hit & ( 1ull << r );
+						if ( path[ i + r ].f_alive )
+							add_hit( i + r, idata[ r ] );
+					}
+					i += count;
+					continue;
+				}
+
+				auto const [f_hit, hit_distance, ray_idata] = scene.intersect( path[ i ].ray );
+				path[ i ].f_alive = f_hit;
+				if ( f_hit )
+					add_hit( i, ray_idata );
+				++i;
+			}
+
+			// Counting sort
+			for ( uint32_t m = 0; m < n_material; ++m )
+				material_offset[ m + 1 ] += material_offset[ m ];
+			shade_order.resize( material_offset[ n_material ] );
+			for ( uint32_t i = 0; i < path.size(); ++i )
+				if ( path[ i ].f_alive )
+					shade_order[ material_offset[ hit[ i ].material_id ]++ ] = i;
+		};
+
+	}; // end wavefront class
+
+};
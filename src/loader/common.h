@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <omp.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../mathematics/aabb.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+
+namespace Loader
+{
+
+	struct Options
+	{
+		// Scene materials, names in the file are matched against these, anything else gets the first one
+		std::vector<std::string> material_name;
+		// Scale uniformly and move the mesh to stand centred on the floor of this box, empty keeps file coordinates
+		AABB fit;
+	};
+
+	// Uniform scale and translation applied to every vertex while triangles are written
+	struct Transform
+	{
+		Real scale{ 1 };
+		Real3 offset{ Real3::Zero };
+
+		Real3 operator () ( Real3 const& position ) const { return position * scale + offset; };
+	};
+
+	// Index of name in the scene materials, the first material if not found
+	inline uint32_t material_id(
+		std::string_view const& name,
+		Loader::Options const& options
+	)
+	{
+		for ( uint32_t i = 0; i < options.material_name.size(); ++i )
+			if ( options.material_name[ i ] == name )
+				return i;
+		return 0;
+	};
+
+	// Split text into about one chunk per few hundred KB, more than threads so the work balances.
+	// Boundaries are moved past the next newline, so lines never straddle two chunks.
+	// Chunk i is [ boundary[ i ], boundary[ i + 1 ] [.
+	inline std::vector<size_t> split_lines(
+		char const* data,
+		size_t const& begin,
+		size_t const& end
+	)
+	{
+		size_t const n_chunk = std::clamp<size_t>( ( end - begin ) >> 18, 1, 16 * static_cast<size_t>( omp_get_max_threads() ) );
+		std::vector<size_t> boundary{ begin };
+		for ( size_t i = 1; i < n_chunk; ++i )
+		{
+			size_t position = std::max( begin + ( end - begin ) * i / n_chunk, boundary.back() );
+			while ( ( position < end ) && ( data[ position - 1 ] != '\n' ) )
+				++position;
+			boundary.push_back( position );
+		}
+		boundary.push_back( end );
+		return boundary;
+	};
+
+	// Transform that fits the vertices into options.fit, identity if it is empty
+	inline Loader::Transform fit(
+		std::vector<Real3> const& vertex,
+		Loader::Options const& options
+	)
+	{
+		if ( options.fit.is_empty() || vertex.empty() )
+			return {};
+
+		// Parallel reduction of the bound, one per thread
+		std::vector<AABB> thread_bound( omp_get_max_threads() );
+#pragma omp parallel
+		{
+			AABB bound;
+#pragma omp for schedule( static )
+			for ( size_t i = 0; i < vertex.size(); ++i )
+				bound = bound + vertex[ i ];
+			thread_bound[ omp_get_thread_num() ] = bound;
+		}
+		AABB bound;
+		for ( AABB const& b : thread_bound )
+			bound = bound + b;
+
+		Real3 const extent = bound.extent();
+		Real3 const target = options.fit.extent();
+		Real scale = std::numeric_limits<Real>::max();
+		for ( uint8_t axis = 0; axis < 3; ++axis )
+			if ( extent[ axis ] > 0. )
+				scale = std::min( scale, target[ axis ] / extent[ axis ] );
+		if ( scale == std::numeric_limits<Real>::max() )
+			scale = 1;
+
+		// Centred on x and y, resting on the bottom in z (world up)
+		Real3 const centre = bound.centre();
+		Real3 const target_centre = options.fit.centre();
+		return { scale, Real3( target_centre.x - centre.x * scale, target_centre.y - centre.y * scale, options.fit.minimum.z - bound.minimum.z * scale ) };
+	};
+
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "../geometry/mesh.h"
+#include "../loader/common.h"
+#include "../loader/mapped_file.h"
+#include "../loader/obj.h"
+#include "../loader/ply.h"
+
+namespace Loader
+{
+
+	// Append the triangles of an .obj or binary .ply file to the mesh, chosen by extension
+	inline bool load(
+		std::string const& file_name,
+		Geometry::Mesh& mesh,
+		Loader::Options const& options
+	)
+	{
+		auto has_extension = [ & ]( std::string const& extension )
+			{
+				return ( file_name.size() > extension.size() ) && ( file_name.compare( file_name.size() - extension.size(), extension.size(), extension ) == 0 );
+			};
+
+		bool const f_obj = has_extension( ".obj" ) || has_extension( ".OBJ" );
+		bool const f_ply = has_extension( ".ply" ) || has_extension( ".PLY" );
+		if ( !f_obj && !f_ply )
+		{
+			std::cout << "Unknown mesh format " << file_name << ", use .obj or .ply." << std::endl;
+			return false;
+		}
+
+		Loader::MappedFile const file( file_name );
+		if ( !file.f_valid() )
+		{
+			std::cout << "Could not open " << file_name << "." << std::endl;
+			return false;
+		}
+
+		return f_obj ? Loader::OBJ::load( file, mesh, options ) : Loader::PLY::load( file, mesh, options );
+	};
+
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Loader
+{
+
+	// Read only memory map of a whole file, unmapped on destruction.
+	// Pages are faulted in by whichever thread touches them first, so parallel parsers also read in parallel.
+	class MappedFile final
+	{
+
+	private:
+
+		char const* memory{ nullptr };
+		size_t length{ 0 };
+
+	public:
+
+		MappedFile() = delete;
+		MappedFile( MappedFile const& ) = delete;
+		MappedFile& operator = ( MappedFile const& ) = delete;
+
+		MappedFile(
+			std::string const& file_name
+		)
+		{
+			int const descriptor = ::open( file_name.c_str(), O_RDONLY );
+			if ( descriptor < 0 )
+				return;
+
+			struct stat status;
+			if ( ( ::fstat( descriptor, &status ) == 0 ) && ( status.st_size > 0 ) )
+			{
+				void* const address = ::mmap( nullptr, static_cast<size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, descriptor, 0 );
+				if ( address != MAP_FAILED )
+				{
+					memory = static_cast<char const*>( address );
+					length = static_cast<size_t>( status.st_size );
+					::madvise( address, length, MADV_WILLNEED );
+				}
+			}
+			// The mapping stays valid once the descriptor is closed
+			::close( descriptor );
+		};
+
+		~MappedFile()
+		{
+			if ( memory )
+				::munmap( const_cast<char*>( memory ), length );
+		};
+
+		bool f_valid() const { return memory != nullptr; };
+
+		char const* data() const { return memory; };
+
+		size_t size() const { return length; };
+
+	};
+
+};
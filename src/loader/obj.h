@@ -0,0 +1,244 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "../geometry/mesh.h"
+#include "../loader/common.h"
+#include "../loader/mapped_file.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+
+namespace Loader
+{
+
+	namespace OBJ
+	{
+
+		inline bool is_space( char const c ) { return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ); };
+
+		inline char const* skip_space( char const* p, char const* end )
+		{
+			while ( ( p < end ) && is_space( *p ) )
+				++p;
+			return p;
+		};
+
+		inline char const* skip_token( char const* p, char const* end )
+		{
+			while ( ( p < end ) && !is_space( *p ) )
+				++p;
+			return p;
+		};
+
+		// Keyword of a line, the rest of the line follows it
+		enum class Line : uint8_t
+		{
+			other,
+			vertex,
+			face,
+			material
+		};
+
+		inline Line classify( char const*& p, char const* end )
+		{
+			p = skip_space( p, end );
+			char const* const keyword = p;
+			p = skip_token( p, end );
+			std::string_view const word( keyword, p - keyword );
+			if ( word == "v" )
+				return Line::vertex;
+			if ( word == "f" )
+				return Line::face;
+			if ( word == "usemtl" )
+				return Line::material;
+			return Line::other;
+		};
+
+		// Material name, trailing white space removed
+		inline std::string_view name( char const* p, char const* end )
+		{
+			p = skip_space( p, end );
+			while ( ( end > p ) && is_space( end[ -1 ] ) )
+				--end;
+			return std::string_view( p, end - p );
+		};
+
+		// Calls f( line_begin, line_end ) for each line of [ begin, end [, without the newline
+		template<typename F>
+		inline void for_each_line( char const* begin, char const* end, F&& f )
+		{
+			while ( begin < end )
+			{
+				char const* newline = static_cast<char const*>( std::memchr( begin, '\n', end - begin ) );
+				char const* const line_end = newline ? newline : end;
+				f( begin, line_end );
+				begin = line_end + 1;
+			}
+		};
+
+		// Wavefront OBJ, only positions, faces and usemtl are used.
+		// Three parallel sweeps over the mapped text, split into chunks at line boundaries:
+		// count vertices and triangles per chunk, parse vertices to their global offsets,
+		// then triangulate faces (as fans) straight into the mesh.
+		inline bool load(
+			Loader::MappedFile const& file,
+			Geometry::Mesh& mesh,
+			Loader::Options const& options
+		)
+		{
+			char const* const data = file.data();
+			std::vector<size_t> const boundary = Loader::split_lines( data, 0, file.size() );
+			int64_t const n_chunk = static_cast<int64_t>( boundary.size() ) - 1;
+
+			struct Count
+			{
+				size_t vertex{ 0 };
+				size_t triangle{ 0 };
+				// Last usemtl of the chunk, if any
+				int64_t material{ -1 };
+			};
+			std::vector<Count> count( n_chunk );
+
+#pragma omp parallel for schedule( dynamic, 1 )
+			for ( int64_t c = 0; c < n_chunk; ++c )
+			{
+				Count& n = count[ c ];
+				for_each_line( data + boundary[ c ], data + boundary[ c + 1 ], [ & ]( char const* p, char const* end )
+					{
+						switch ( classify( p, end ) )
+						{
+						case Line::vertex:
+							++n.vertex;
+							break;
+						case Line::face:
+						{
+							size_t corner{ 0 };
+							for ( p = skip_space( p, end ); p < end; p = skip_space( skip_token( p, end ), end ) )
+								++corner;
+							n.triangle += corner > 2 ? corner - 2 : 0;
+							break;
+						}
+						case Line::material:
+							n.material = Loader::material_id( name( p, end ), options );
+							break;
+						default:
+							break;
+						}
+					} );
+			}
+
+			// Offsets of each chunk, and the material in effect where it starts
+			std::vector<Count> start( n_chunk + 1 );
+			start[ 0 ].material = 0;
+			for ( int64_t c = 0; c < n_chunk; ++c )
+			{
+				start[ c + 1 ].vertex = start[ c ].vertex + count[ c ].vertex;
+				start[ c + 1 ].triangle = start[ c ].triangle + count[ c ].triangle;
+				start[ c + 1 ].material = count[ c ].material >= 0 ? count[ c ].material : start[ c ].material;
+			}
+			size_t const n_vertex = start[ n_chunk ].vertex;
+			size_t const n_triangle = start[ n_chunk ].triangle;
+			uint32_t const first = mesh.size();
+			if ( n_triangle > std::numeric_limits<uint32_t>::max() - first )
+			{
+				std::cout << "OBJ has too many triangles." << std::endl;
+				return false;
+			}
+
+			std::vector<Real3> vertex( n_vertex );
+			bool f_error{ false };
+#pragma omp parallel for schedule( dynamic, 1 ) reduction( || : f_error )
+			for ( int64_t c = 0; c < n_chunk; ++c )
+			{
+				Real3* v = vertex.data() + start[ c ].vertex;
+				for_each_line( data + boundary[ c ], data + boundary[ c + 1 ], [ & ]( char const* p, char const* end )
+					{
+						if ( classify( p, end ) != Line::vertex )
+							return;
+						Real3& position = *v++;
+						for ( uint8_t axis = 0; axis < 3; ++axis )
+						{
+							p = skip_space( p, end );
+							// from_chars does not take a leading plus
+							if ( ( p < end ) && ( *p == '+' ) )
+								++p;
+							Real value{ 0 };
+							std::from_chars_result const result = std::from_chars( p, end, value );
+							f_error |= result.ec != std::errc();
+							p = result.ptr;
+							( axis == 0 ? position.x : ( axis == 1 ? position.y : position.z ) ) = value;
+						}
+					} );
+			}
+			if ( f_error )
+			{
+				std::cout << "OBJ has malformed vertex positions." << std::endl;
+				return false;
+			}
+
+			Loader::Transform const transform = Loader::fit( vertex, options );
+
+			mesh.resize( static_cast<uint32_t>( first + n_triangle ) );
+#pragma omp parallel for schedule( dynamic, 1 ) reduction( || : f_error )
+			for ( int64_t c = 0; c < n_chunk; ++c )
+			{
+				// Relative (negative) indices count back from the vertices read so far
+				size_t n_seen = start[ c ].vertex;
+				uint32_t id = static_cast<uint32_t>( first + start[ c ].triangle );
+				uint32_t material = static_cast<uint32_t>( start[ c ].material );
+				std::vector<size_t> corner;
+				for_each_line( data + boundary[ c ], data + boundary[ c + 1 ], [ & ]( char const* p, char const* end )
+					{
+						switch ( classify( p, end ) )
+						{
+						case Line::vertex:
+							++n_seen;
+							break;
+						case Line::material:
+							material = Loader::material_id( name( p, end ), options );
+							break;
+						case Line::face:
+						{
+							// Corners are v, v/vt, v//vn or v/vt/vn, only v is used
+							corner.clear();
+							for ( p = skip_space( p, end ); p < end; p = skip_space( skip_token( p, end ), end ) )
+							{
+								int64_t index{ 0 };
+								std::from_chars_result const result = std::from_chars( p, end, index );
+								size_t const v = index > 0 ? static_cast<size_t>( index - 1 ) : n_seen + index;
+								if ( ( result.ec != std::errc() ) || ( index == 0 ) || ( v >= n_vertex ) )
+									f_error = true;
+								else
+									corner.push_back( v );
+							}
+							// Invalid corners fail the load, fewer triangles than counted are never written past the chunk
+							if ( f_error )
+								break;
+							for ( size_t i = 2; i < corner.size(); ++i )
+								mesh.set( id++, transform( vertex[ corner[ 0 ] ] ), transform( vertex[ corner[ i - 1 ] ] ), transform( vertex[ corner[ i ] ] ), material );
+							break;
+						}
+						default:
+							break;
+						}
+					} );
+			}
+			if ( f_error )
+			{
+				mesh.resize( first );
+				std::cout << "OBJ has faces with invalid vertex indices." << std::endl;
+				return false;
+			}
+
+			return true;
+		};
+
+	};
+
+};
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../geometry/mesh.h"
+#include "../loader/common.h"
+#include "../loader/mapped_file.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+
+namespace Loader
+{
+
+	namespace PLY
+	{
+
+		enum class Type : uint8_t
+		{
+			int8,
+			uint8,
+			int16,
+			uint16,
+			int32,
+			uint32,
+			float32,
+			float64,
+			invalid
+		};
+
+		inline Type parse_type( std::string const& name )
+		{
+			if ( ( name == "char" ) || ( name == "int8" ) ) return Type::int8;
+			if ( ( name == "uchar" ) || ( name == "uint8" ) ) return Type::uint8;
+			if ( ( name == "short" ) || ( name == "int16" ) ) return Type::int16;
+			if ( ( name == "ushort" ) || ( name == "uint16" ) ) return Type::uint16;
+			if ( ( name == "int" ) || ( name == "int32" ) ) return Type::int32;
+			if ( ( name == "uint" ) || ( name == "uint32" ) ) return Type::uint32;
+			if ( ( name == "float" ) || ( name == "float32" ) ) return Type::float32;
+			if ( ( name == "double" ) || ( name == "float64" ) ) return Type::float64;
+			return Type::invalid;
+		};
+
+		inline size_t size( Type const type )
+		{
+			constexpr size_t type_size[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+			return type_size[ static_cast<uint8_t>( type ) ];
+		};
+
+		// Little endian value at p, the host is assumed little endian too (x86)
+		template<typename T>
+		inline T read( char const* p, Type const type )
+		{
+			switch ( type )
+			{
+			case Type::int8: { int8_t v; std::memcpy( &v, p, 1 ); return static_cast<T>( v ); }
+			case Type::uint8: { uint8_t v; std::memcpy( &v, p, 1 ); return static_cast<T>( v ); }
+			case Type::int16: { int16_t v; std::memcpy( &v, p, 2 ); return static_cast<T>( v ); }
+			case Type::uint16: { uint16_t v; std::memcpy( &v, p, 2 ); return static_cast<T>( v ); }
+			case Type::int32: { int32_t v; std::memcpy( &v, p, 4 ); return static_cast<T>( v ); }
+			case Type::uint32: { uint32_t v; std::memcpy( &v, p, 4 ); return static_cast<T>( v ); }
+			case Type::float32: { float v; std::memcpy( &v, p, 4 ); return static_cast<T>( v ); }
+			case Type::float64: { double v; std::memcpy( &v, p, 8 ); return static_cast<T>( v ); }
+			default: return T( 0 );
+			}
+		};
+
+		struct Property
+		{
+			std::string name;
+			Type type{ Type::invalid };
+			// Lists store their length as count_type, then that many values of type
+			Type count_type{ Type::invalid };
+
+			bool f_list() const { return count_type != Type::invalid; };
+		};
+
+		struct Element
+		{
+			std::string name;
+			size_t count{ 0 };
+			std::vector<Property> property;
+
+			// Bytes per row, zero if a list makes it variable
+			size_t stride() const
+			{
+				size_t bytes{ 0 };
+				for ( Property const& p : property )
+				{
+					if ( p.f_list() )
+						return 0;
+					bytes += PLY::size( p.type );
+				}
+				return bytes;
+			};
+
+			// Bytes of the row starting at p, zero if it does not end by end
+			size_t row_size( char const* p, char const* end ) const
+			{
+				char const* const row = p;
+				for ( Property const& q : property )
+				{
+					if ( q.f_list() )
+					{
+						if ( static_cast<size_t>( end - p ) < PLY::size( q.count_type ) )
+							return 0;
+						size_t const n = PLY::read<size_t>( p, q.count_type );
+						if ( n > static_cast<size_t>( end - p - PLY::size( q.count_type ) ) / PLY::size( q.type ) )
+							return 0;
+						p += PLY::size( q.count_type ) + n * PLY::size( q.type );
+					}
+					else
+					{
+						if ( static_cast<size_t>( end - p ) < PLY::size( q.type ) )
+							return 0;
+						p += PLY::size( q.type );
+					}
+				}
+				return p - row;
+			};
+
+			int64_t find( std::string_view const& property_name ) const
+			{
+				for ( size_t i = 0; i < property.size(); ++i )
+					if ( property[ i ].name == property_name )
+						return static_cast<int64_t>( i );
+				return -1;
+			};
+		};
+
+		// Rows of faces are handed to threads in blocks of this many
+		static constexpr size_t face_block{ 1 << 16 };
+
+		// Binary little endian PLY, vertex x y z and the face vertex index list are used.
+		// Vertices have a fixed stride and are decoded in parallel. Face rows vary in length, so the
+		// sequential pass that skips elements records where each block of rows starts and how many
+		// triangles precede it, then blocks are triangulated (as fans) in parallel straight into the mesh.
+		// Material names are not part of PLY, all faces get the first scene material.
+		inline bool load(
+			Loader::MappedFile const& file,
+			Geometry::Mesh& mesh,
+			Loader::Options const& options
+		)
+		{
+			char const* const data = file.data();
+			size_t const file_size = file.size();
+
+			// Header, plain text up to and including the end_header line
+			std::string_view const text( data, file_size );
+			size_t const header_end = text.find( "end_header" );
+			size_t const body = header_end == std::string_view::npos ? file_size : text.find( '\n', header_end );
+			if ( ( text.substr( 0, 3 ) != "ply" ) || ( body == std::string_view::npos ) || ( body >= file_size ) )
+			{
+				std::cout << "PLY header is malformed." << std::endl;
+				return false;
+			}
+
+			std::vector<Element> element;
+			std::istringstream header( std::string( data, body ) );
+			std::string line;
+			bool f_binary{ false };
+			while ( std::getline( header, line ) )
+			{
+				std::istringstream words( line );
+				std::string keyword;
+				words >> keyword;
+				if ( keyword == "format" )
+				{
+					std::string format;
+					words >> format;
+					f_binary = format == "binary_little_endian";
+				}
+				else if ( keyword == "element" )
+				{
+					element.emplace_back();
+					words >> element.back().name >> element.back().count;
+				}
+				else if ( ( keyword == "property" ) && !element.empty() )
+				{
+					Property p;
+					std::string type;
+					words >> type;
+					if ( type == "list" )
+					{
+						std::string count_type;
+						words >> count_type >> type;
+						p.count_type = PLY::parse_type( count_type );
+						if ( p.count_type == Type::invalid )
+							type.clear();
+					}
+					p.type = PLY::parse_type( type );
+					words >> p.name;
+					if ( p.type == Type::invalid )
+					{
+						std::cout << "PLY property " << p.name << " has an unknown type." << std::endl;
+						return false;
+					}
+					element.back().property.push_back( p );
+				}
+			}
+			if ( !f_binary )
+			{
+				std::cout << "Only binary little endian PLY is supported." << std::endl;
+				return false;
+			}
+
+			// Locate the vertex and face elements, skip any other
+			Element const* vertex_element{ nullptr };
+			Element const* face_element{ nullptr };
+			size_t vertex_offset{ 0 };
+			int64_t index_property{ -1 };
+			// Offset of the index list within a face row
+			size_t list_offset{ 0 };
+			// Where each block of face rows starts, and the triangles before it
+			std::vector<size_t> block_offset;
+			std::vector<size_t> block_triangle;
+			size_t offset = body + 1;
+			for ( Element const& e : element )
+			{
+				size_t const stride = e.stride();
+				if ( e.name == "vertex" )
+				{
+					vertex_element = &e;
+					vertex_offset = offset;
+				}
+				else if ( e.name == "face" )
+				{
+					face_element = &e;
+					index_property = e.find( "vertex_indices" );
+					if ( index_property < 0 )
+						index_property = e.find( "vertex_index" );
+					bool f_fixed_offset = index_property >= 0 && e.property[ index_property ].f_list();
+					for ( int64_t j = 0; j < index_property; ++j )
+					{
+						f_fixed_offset &= !e.property[ j ].f_list();
+						list_offset += PLY::size( e.property[ j ].type );
+					}
+					if ( !f_fixed_offset )
+					{
+						std::cout << "PLY faces need a vertex_indices list, with no list ahead of it." << std::endl;
+						return false;
+					}
+
+					// Face rows vary in length, one light sequential scan of the list lengths
+					Type const count_type = e.property[ index_property ].count_type;
+					size_t n_triangle{ 0 };
+					size_t i{ 0 };
+					for ( ; i < e.count; ++i )
+					{
+						// The whole row has to be in the file, the parallel pass reads it unchecked
+						size_t const row = offset < file_size ? e.row_size( data + offset, data + file_size ) : 0;
+						if ( row == 0 )
+							break;
+						if ( i % face_block == 0 )
+						{
+							block_offset.push_back( offset );
+							block_triangle.push_back( n_triangle );
+						}
+						size_t const corner = PLY::read<size_t>( data + offset + list_offset, count_type );
+						n_triangle += corner > 2 ? corner - 2 : 0;
+						offset += row;
+					}
+					block_offset.push_back( offset );
+					block_triangle.push_back( n_triangle );
+					// Rows missing at the end of the file
+					if ( i < e.count )
+						offset = file_size + 1;
+					continue;
+				}
+				if ( stride > 0 )
+				{
+					// Compared before adding, a crafted count could wrap the offset back inside the file
+					if ( ( offset > file_size ) || ( e.count > ( file_size - offset ) / stride ) )
+						offset = file_size + 1;
+					else
+						offset += e.count * stride;
+				}
+				else
+					for ( size_t i = 0; i < e.count; ++i )
+					{
+						size_t const row = offset < file_size ? e.row_size( data + offset, data + file_size ) : 0;
+						if ( row == 0 )
+						{
+							offset = file_size + 1;
+							break;
+						}
+						offset += row;
+					}
+			}
+			if ( !vertex_element || !face_element || ( offset > file_size ) )
+			{
+				std::cout << "PLY has no vertex or face element, or is truncated." << std::endl;
+				return false;
+			}
+
+			int64_t const axis_property[ 3 ] = { vertex_element->find( "x" ), vertex_element->find( "y" ), vertex_element->find( "z" ) };
+			if ( ( axis_property[ 0 ] < 0 ) || ( axis_property[ 1 ] < 0 ) || ( axis_property[ 2 ] < 0 ) || ( vertex_element->stride() == 0 ) )
+			{
+				std::cout << "PLY vertices need fixed size x y z properties." << std::endl;
+				return false;
+			}
+
+			// Byte offset of each axis within a vertex row
+			size_t const vertex_stride = vertex_element->stride();
+			size_t axis_offset[ 3 ];
+			Type axis_type[ 3 ];
+			for ( uint8_t axis = 0; axis < 3; ++axis )
+			{
+				axis_offset[ axis ] = 0;
+				for ( int64_t i = 0; i < axis_property[ axis ]; ++i )
+					axis_offset[ axis ] += PLY::size( vertex_element->property[ i ].type );
+				axis_type[ axis ] = vertex_element->property[ axis_property[ axis ] ].type;
+			}
+
+			size_t const n_vertex = vertex_element->count;
+			if ( ( vertex_offset > file_size ) || ( n_vertex > ( file_size - vertex_offset ) / vertex_stride ) )
+			{
+				std::cout << "PLY vertices run past the end of the file." << std::endl;
+				return false;
+			}
+			std::vector<Real3> vertex( n_vertex );
+#pragma omp parallel for schedule( static )
+			for ( int64_t i = 0; i < static_cast<int64_t>( n_vertex ); ++i )
+			{
+				char const* const row = data + vertex_offset + i * vertex_stride;
+				vertex[ i ] = Real3(
+					PLY::read<Real>( row + axis_offset[ 0 ], axis_type[ 0 ] ),
+					PLY::read<Real>( row + axis_offset[ 1 ], axis_type[ 1 ] ),
+					PLY::read<Real>( row + axis_offset[ 2 ], axis_type[ 2 ] ) );
+			}
+
+			Loader::Transform const transform = Loader::fit( vertex, options );
+
+			Property const& index_list = face_element->property[ index_property ];
+			size_t const n_face = face_element->count;
+			size_t const n_block = block_offset.size() - 1;
+			uint32_t const first = mesh.size();
+			size_t const n_triangle = block_triangle[ n_block ];
+			if ( n_triangle > std::numeric_limits<uint32_t>::max() - first )
+			{
+				std::cout << "PLY has too many triangles." << std::endl;
+				return false;
+			}
+
+			mesh.resize( static_cast<uint32_t>( first + n_triangle ) );
+			size_t const index_size = PLY::size( index_list.type );
+			// No material names in PLY, the first scene material
+			uint32_t const material{ 0 };
+			bool f_error{ false };
+#pragma omp parallel for schedule( dynamic, 1 ) reduction( || : f_error )
+			for ( int64_t b = 0; b < static_cast<int64_t>( n_block ); ++b )
+			{
+				char const* p = data + block_offset[ b ];
+				uint32_t id = static_cast<uint32_t>( first + block_triangle[ b ] );
+				size_t const last = std::min( n_face, static_cast<size_t>( b + 1 ) * face_block );
+				for ( size_t i = b * face_block; i < last; ++i )
+				{
+					char const* const row = p;
+					char const* list = row + list_offset;
+					size_t const corner = PLY::read<size_t>( list, index_list.count_type );
+					list += PLY::size( index_list.count_type );
+					size_t const v0 = PLY::read<size_t>( list, index_list.type );
+					for ( size_t k = 2; k < corner; ++k )
+					{
+						size_t const v1 = PLY::read<size_t>( list + ( k - 1 ) * index_size, index_list.type );
+						size_t const v2 = PLY::read<size_t>( list + k * index_size, index_list.type );
+						if ( ( v0 >= n_vertex ) || ( v1 >= n_vertex ) || ( v2 >= n_vertex ) )
+						{
+							f_error = true;
+							continue;
+						}
+						mesh.set( id++, transform( vertex[ v0 ] ), transform( vertex[ v1 ] ), transform( vertex[ v2 ] ), material );
+					}
+					p = row + face_element->row_size( row, data + file_size );
+				}
+			}
+			if ( f_error )
+			{
+				mesh.resize( first );
+				std::cout << "PLY has faces with invalid vertex indices." << std::endl;
+				return false;
+			}
+
+			return true;
+		};
+
+	};
+
+};
@@ -18,16 +18,52 @@
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <string>
 
+#include "dispatch/isa.h"
+#include "render/arguments.h"
 #include "render/config.h"
 #include "render/image.h"
 #include "render/scene.h"
+#include "stats/trace.h"
 
 int main( int argc, char* argv[] )
 {
-	Render::Config const config( 800, 800, 1, 5 );
+	Render::Config config( 800, 800, 0, 5 );
+	bool f_save_passes{ false };
+	std::string stats_file;
+	std::string trace_file;
 
+	for ( int i = 1; i < argc; ++i )
+	{
+		Render::Argument const parsed = Render::parse_argument( argc, argv, i, config );
+		if ( parsed == Render::Argument::invalid )
+			return EXIT_FAILURE;
+		if ( parsed == Render::Argument::used )
+			continue;
+
+		std::string const argument( argv[ i ] );
+		// Save the image after every pass
+		if ( argument == "--save-passes" )
+			f_save_passes = true;
+		// Write the hot path counters as JSON
+		else if ( ( argument == "--stats" ) && ( i + 1 < argc ) )
+			stats_file = argv[ ++i ];
+		// Write the timeline of the render phases as Chrome trace JSON
+		else if ( ( argument == "--trace" ) && ( i + 1 < argc ) )
+			trace_file = argv[ ++i ];
+		else
+		{
+			std::cout << "Unknown argument " << argument << "." << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::cout << "Instruction set: " << Dispatch::name( config.isa ) << ( config.isa == Dispatch::detect() ? "" : " (override)" ) << "." << std::endl;
+
+	std::chrono::steady_clock::time_point const scene_start = std::chrono::steady_clock::now();
 	Render::Scene const scene( config );
+	std::chrono::milliseconds const scene_time = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - scene_start );
+	std::cout << "Scene of " << scene.n_object() << " triangles built in " << scene_time.count() << " millie seconds." << std::endl;
 	if ( !scene.n_light() || !scene.n_object() )
 	{
 		std::cout << "Nothing to render, no light and/or object(s)." << std::endl;
@@ -39,11 +75,26 @@ int main( int argc, char* argv[] )
 	std::cout << "Render start." << std::endl;
 	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
 
-	image.render();
+	uint32_t const passes = image.render( [ & ]( uint32_t const& pass, uint16_t const& samples )
+		{
+			std::cout << "Pass " << pass << " done, up to " << samples << " samples per pixel, " << image.active_pixels() << " pixels active." << std::endl;
+			if ( f_save_passes && !image.save( "result" ) )
+				std::cout << "Could not save intermediate image." << std::endl;
+		} );
 
 	std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
 	std::chrono::milliseconds total_time = std::chrono::duration_cast<std::chrono::milliseconds>( stop_time - start_time );
-	std::cout << "Render time: " << total_time.count() << " millie seconds." << std::endl;
+	std::cout << "Render time: " << total_time.count() << " millie seconds, " << passes << " passes." << std::endl;
+
+#ifdef BPT_STATS
+	std::cout << "Statistics:" << std::endl;
+	image.stats().print();
+	if ( !stats_file.empty() && !image.stats().save( stats_file ) )
+		std::cout << "Could not save statistics." << std::endl;
+#else
+	if ( !stats_file.empty() )
+		std::cout << "No statistics, they are only counted by the stats build (make stats)." << std::endl;
+#endif
 
 	std::cout << "Saving image." << std::endl;
 	if ( !image.save( "result" ) )
@@ -52,6 +103,14 @@ int main( int argc, char* argv[] )
 		return EXIT_FAILURE;
 	}
 
+#ifdef BPT_TRACE
+	if ( !trace_file.empty() && !Stats::trace.save( trace_file ) )
+		std::cout << "Could not save trace." << std::endl;
+#else
+	if ( !trace_file.empty() )
+		std::cout << "No trace, it is only recorded by the trace build (make trace)." << std::endl;
+#endif
+
 	std::cout << "Work complete." << std::endl;
 	return EXIT_SUCCESS;
 };
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "../mathematics/vec3.h"
+
+// Axis aligned bounding box
+class AABB final
+{
+
+public:
+
+	// Default is an empty (inverted) box, so any union will replace it
+	Real3 minimum{ std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max() };
+	Real3 maximum{ -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max() };
+
+	AABB() {};
+
+	AABB(
+		Real3 const& a,
+		Real3 const& b
+	)
+		: minimum( std::min( a.x, b.x ), std::min( a.y, b.y ), std::min( a.z, b.z ) ),
+		maximum( std::max( a.x, b.x ), std::max( a.y, b.y ), std::max( a.z, b.z ) )
+	{};
+
+	// Union of two boxes
+	AABB operator + ( AABB const& value ) const
+	{
+		AABB result;
+		result.minimum = Real3( std::min( minimum.x, value.minimum.x ), std::min( minimum.y, value.minimum.y ), std::min( minimum.z, value.minimum.z ) );
+		result.maximum = Real3( std::max( maximum.x, value.maximum.x ), std::max( maximum.y, value.maximum.y ), std::max( maximum.z, value.maximum.z ) );
+		return result;
+	};
+
+	// Union of box and point
+	AABB operator + ( Real3 const& value ) const
+	{
+		AABB result;
+		result.minimum = Real3( std::min( minimum.x, value.x ), std::min( minimum.y, value.y ), std::min( minimum.z, value.z ) );
+		result.maximum = Real3( std::max( maximum.x, value.x ), std::max( maximum.y, value.y ), std::max( maximum.z, value.z ) );
+		return result;
+	};
+
+	bool is_empty() const { return ( minimum.x > maximum.x ) || ( minimum.y > maximum.y ) || ( minimum.z > maximum.z ); };
+
+	Real3 centre() const { return ( minimum + maximum ) * 0.5; };
+
+	Real3 extent() const { return is_empty() ? Real3::Zero : maximum - minimum; };
+
+	// Half the surface area is enough for the surface area heuristic, but full area is less confusing
+	Real area() const
+	{
+		Real3 const e = extent();
+		return 2.0 * ( e.x * e.y + e.y * e.z + e.z * e.x );
+	};
+
+	// Axis with the largest extent, 0 = x, 1 = y, 2 = z
+	uint8_t longest_axis() const
+	{
+		Real3 const e = extent();
+		if ( ( e.x >= e.y ) && ( e.x >= e.z ) )
+			return 0;
+		return ( e.y >= e.z ) ? 1 : 2;
+	};
+
+	// Slab test, inverse direction is precomputed by the caller
+	// Returns entry distance, negative if the box is missed or further away than max_distance
+	Real intersect(
+		Real3 const& origin,
+		Real3 const& inv_direction,
+		Real const& max_distance
+	) const
+	{
+		Real const tx0 = ( minimum.x - origin.x ) * inv_direction.x;
+		Real const tx1 = ( maximum.x - origin.x ) * inv_direction.x;
+		Real const ty0 = ( minimum.y - origin.y ) * inv_direction.y;
+		Real const ty1 = ( maximum.y - origin.y ) * inv_direction.y;
+		Real const tz0 = ( minimum.z - origin.z ) * inv_direction.z;
+		Real const tz1 = ( maximum.z - origin.z ) * inv_direction.z;
+
+		Real const t_near = std::max( { std::min( tx0, tx1 ), std::min( ty0, ty1 ), std::min( tz0, tz1 ), Real( 0 ) } );
+		Real const t_far = std::min( { std::max( tx0, tx1 ), std::max( ty0, ty1 ), std::max( tz0, tz1 ), max_distance } );
+
+		return t_near <= t_far ? t_near : -1.0;
+	};
+
+};
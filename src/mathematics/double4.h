@@ -0,0 +1,82 @@
+// Four doubles in one AVX register, or in two SSE2 registers for the baseline kernels.
+// No include guard, dispatch/kernel.h includes this once per instruction set,
+// BPT_KERNEL_AVX is set there for the variants compiled with AVX enabled.
+class Double4 final
+{
+
+public:
+
+#if defined( BPT_KERNEL_AVX )
+	__m256d v;
+
+	Double4() : v( _mm256_setzero_pd() ) {};
+
+	Double4( __m256d const& v ) : v( v ) {};
+
+	Double4( double const& value ) : v( _mm256_set1_pd( value ) ) {};
+
+	// Aligned load of four consecutive values
+	static Double4 load( double const* p ) { return Double4( _mm256_load_pd( p ) ); };
+
+	Double4 operator + ( Double4 const& value ) const { return _mm256_add_pd( v, value.v ); };
+	Double4 operator - ( Double4 const& value ) const { return _mm256_sub_pd( v, value.v ); };
+	Double4 operator * ( Double4 const& value ) const { return _mm256_mul_pd( v, value.v ); };
+	Double4 operator / ( Double4 const& value ) const { return _mm256_div_pd( v, value.v ); };
+
+	// Comparisons return a lane mask
+	Double4 operator < ( Double4 const& value ) const { return _mm256_cmp_pd( v, value.v, _CMP_LT_OQ ); };
+	Double4 operator <= ( Double4 const& value ) const { return _mm256_cmp_pd( v, value.v, _CMP_LE_OQ ); };
+	Double4 operator > ( Double4 const& value ) const { return _mm256_cmp_pd( v, value.v, _CMP_GT_OQ ); };
+	Double4 operator >= ( Double4 const& value ) const { return _mm256_cmp_pd( v, value.v, _CMP_GE_OQ ); };
+
+	Double4 operator & ( Double4 const& value ) const { return _mm256_and_pd( v, value.v ); };
+	Double4 operator | ( Double4 const& value ) const { return _mm256_or_pd( v, value.v ); };
+
+	static Double4 min( Double4 const& a, Double4 const& b ) { return _mm256_min_pd( a.v, b.v ); };
+	static Double4 max( Double4 const& a, Double4 const& b ) { return _mm256_max_pd( a.v, b.v ); };
+
+	Double4 abs() const { return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ), v ); };
+
+	// One bit per lane, from the sign bit (set by comparisons)
+	uint8_t mask() const { return static_cast<uint8_t>( _mm256_movemask_pd( v ) ); };
+
+	void store( double* p ) const { _mm256_store_pd( p, v ); };
+#else
+	__m128d lo;
+	__m128d hi;
+
+	Double4() : lo( _mm_setzero_pd() ), hi( _mm_setzero_pd() ) {};
+
+	Double4( __m128d const& lo, __m128d const& hi ) : lo( lo ), hi( hi ) {};
+
+	Double4( double const& value ) : lo( _mm_set1_pd( value ) ), hi( _mm_set1_pd( value ) ) {};
+
+	// Aligned load of four consecutive values
+	static Double4 load( double const* p ) { return Double4( _mm_load_pd( p ), _mm_load_pd( p + 2 ) ); };
+
+	Double4 operator + ( Double4 const& value ) const { return Double4( _mm_add_pd( lo, value.lo ), _mm_add_pd( hi, value.hi ) ); };
+	Double4 operator - ( Double4 const& value ) const { return Double4( _mm_sub_pd( lo, value.lo ), _mm_sub_pd( hi, value.hi ) ); };
+	Double4 operator * ( Double4 const& value ) const { return Double4( _mm_mul_pd( lo, value.lo ), _mm_mul_pd( hi, value.hi ) ); };
+	Double4 operator / ( Double4 const& value ) const { return Double4( _mm_div_pd( lo, value.lo ), _mm_div_pd( hi, value.hi ) ); };
+
+	// Comparisons return a lane mask
+	Double4 operator < ( Double4 const& value ) const { return Double4( _mm_cmplt_pd( lo, value.lo ), _mm_cmplt_pd( hi, value.hi ) ); };
+	Double4 operator <= ( Double4 const& value ) const { return Double4( _mm_cmple_pd( lo, value.lo ), _mm_cmple_pd( hi, value.hi ) ); };
+	Double4 operator > ( Double4 const& value ) const { return Double4( _mm_cmpgt_pd( lo, value.lo ), _mm_cmpgt_pd( hi, value.hi ) ); };
+	Double4 operator >= ( Double4 const& value ) const { return Double4( _mm_cmpge_pd( lo, value.lo ), _mm_cmpge_pd( hi, value.hi ) ); };
+
+	Double4 operator & ( Double4 const& value ) const { return Double4( _mm_and_pd( lo, value.lo ), _mm_and_pd( hi, value.hi ) ); };
+	Double4 operator | ( Double4 const& value ) const { return Double4( _mm_or_pd( lo, value.lo ), _mm_or_pd( hi, value.hi ) ); };
+
+	static Double4 min( Double4 const& a, Double4 const& b ) { return Double4( _mm_min_pd( a.lo, b.lo ), _mm_min_pd( a.hi, b.hi ) ); };
+	static Double4 max( Double4 const& a, Double4 const& b ) { return Double4( _mm_max_pd( a.lo, b.lo ), _mm_max_pd( a.hi, b.hi ) ); };
+
+	Double4 abs() const { __m128d const sign = _mm_set1_pd( -0.0 ); return Double4( _mm_andnot_pd( sign, lo ), _mm_andnot_pd( sign, hi ) ); };
+
+	// One bit per lane, from the sign bit (set by comparisons)
+	uint8_t mask() const { return static_cast<uint8_t>( _mm_movemask_pd( lo ) | ( _mm_movemask_pd( hi ) << 2 ) ); };
+
+	void store( double* p ) const { _mm_store_pd( p, lo ); _mm_store_pd( p + 2, hi ); };
+#endif
+
+};
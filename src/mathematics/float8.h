@@ -0,0 +1,82 @@
+// Eight floats in one AVX register, or in two SSE registers for the baseline kernels.
+// No include guard, dispatch/kernel.h includes this once per instruction set,
+// BPT_KERNEL_AVX is set there for the variants compiled with AVX enabled.
+class Float8 final
+{
+
+public:
+
+#if defined( BPT_KERNEL_AVX )
+	__m256 v;
+
+	Float8() : v( _mm256_setzero_ps() ) {};
+
+	Float8( __m256 const& v ) : v( v ) {};
+
+	Float8( float const& value ) : v( _mm256_set1_ps( value ) ) {};
+
+	// Aligned load of eight consecutive values
+	static Float8 load( float const* p ) { return Float8( _mm256_load_ps( p ) ); };
+
+	Float8 operator + ( Float8 const& value ) const { return _mm256_add_ps( v, value.v ); };
+	Float8 operator - ( Float8 const& value ) const { return _mm256_sub_ps( v, value.v ); };
+	Float8 operator * ( Float8 const& value ) const { return _mm256_mul_ps( v, value.v ); };
+	Float8 operator / ( Float8 const& value ) const { return _mm256_div_ps( v, value.v ); };
+
+	// Comparisons return a lane mask
+	Float8 operator < ( Float8 const& value ) const { return _mm256_cmp_ps( v, value.v, _CMP_LT_OQ ); };
+	Float8 operator <= ( Float8 const& value ) const { return _mm256_cmp_ps( v, value.v, _CMP_LE_OQ ); };
+	Float8 operator > ( Float8 const& value ) const { return _mm256_cmp_ps( v, value.v, _CMP_GT_OQ ); };
+	Float8 operator >= ( Float8 const& value ) const { return _mm256_cmp_ps( v, value.v, _CMP_GE_OQ ); };
+
+	Float8 operator & ( Float8 const& value ) const { return _mm256_and_ps( v, value.v ); };
+	Float8 operator | ( Float8 const& value ) const { return _mm256_or_ps( v, value.v ); };
+
+	static Float8 min( Float8 const& a, Float8 const& b ) { return _mm256_min_ps( a.v, b.v ); };
+	static Float8 max( Float8 const& a, Float8 const& b ) { return _mm256_max_ps( a.v, b.v ); };
+
+	Float8 abs() const { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), v ); };
+
+	// One bit per lane, from the sign bit (set by comparisons)
+	uint8_t mask() const { return static_cast<uint8_t>( _mm256_movemask_ps( v ) ); };
+
+	void store( float* p ) const { _mm256_store_ps( p, v ); };
+#else
+	__m128 lo;
+	__m128 hi;
+
+	Float8() : lo( _mm_setzero_ps() ), hi( _mm_setzero_ps() ) {};
+
+	Float8( __m128 const& lo, __m128 const& hi ) : lo( lo ), hi( hi ) {};
+
+	Float8( float const& value ) : lo( _mm_set1_ps( value ) ), hi( _mm_set1_ps( value ) ) {};
+
+	// Aligned load of eight consecutive values
+	static Float8 load( float const* p ) { return Float8( _mm_load_ps( p ), _mm_load_ps( p + 4 ) ); };
+
+	Float8 operator + ( Float8 const& value ) const { return Float8( _mm_add_ps( lo, value.lo ), _mm_add_ps( hi, value.hi ) ); };
+	Float8 operator - ( Float8 const& value ) const { return Float8( _mm_sub_ps( lo, value.lo ), _mm_sub_ps( hi, value.hi ) ); };
+	Float8 operator * ( Float8 const& value ) const { return Float8( _mm_mul_ps( lo, value.lo ), _mm_mul_ps( hi, value.hi ) ); };
+	Float8 operator / ( Float8 const& value ) const { return Float8( _mm_div_ps( lo, value.lo ), _mm_div_ps( hi, value.hi ) ); };
+
+	// Comparisons return a lane mask
+	Float8 operator < ( Float8 const& value ) const { return Float8( _mm_cmplt_ps( lo, value.lo ), _mm_cmplt_ps( hi, value.hi ) ); };
+	Float8 operator <= ( Float8 const& value ) const { return Float8( _mm_cmple_ps( lo, value.lo ), _mm_cmple_ps( hi, value.hi ) ); };
+	Float8 operator > ( Float8 const& value ) const { return Float8( _mm_cmpgt_ps( lo, value.lo ), _mm_cmpgt_ps( hi, value.hi ) ); };
+	Float8 operator >= ( Float8 const& value ) const { return Float8( _mm_cmpge_ps( lo, value.lo ), _mm_cmpge_ps( hi, value.hi ) ); };
+
+	Float8 operator & ( Float8 const& value ) const { return Float8( _mm_and_ps( lo, value.lo ), _mm_and_ps( hi, value.hi ) ); };
+	Float8 operator | ( Float8 const& value ) const { return Float8( _mm_or_ps( lo, value.lo ), _mm_or_ps( hi, value.hi ) ); };
+
+	static Float8 min( Float8 const& a, Float8 const& b ) { return Float8( _mm_min_ps( a.lo, b.lo ), _mm_min_ps( a.hi, b.hi ) ); };
+	static Float8 max( Float8 const& a, Float8 const& b ) { return Float8( _mm_max_ps( a.lo, b.lo ), _mm_max_ps( a.hi, b.hi ) ); };
+
+	Float8 abs() const { __m128 const sign = _mm_set1_ps( -0.0f ); return Float8( _mm_andnot_ps( sign, lo ), _mm_andnot_ps( sign, hi ) ); };
+
+	// One bit per lane, from the sign bit (set by comparisons)
+	uint8_t mask() const { return static_cast<uint8_t>( _mm_movemask_ps( lo ) | ( _mm_movemask_ps( hi ) << 4 ) ); };
+
+	void store( float* p ) const { _mm_store_ps( p, lo ); _mm_store_ps( p + 4, hi ); };
+#endif
+
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <limits>
+
+// Scalar type of the geometry, intersection and integrator math
+// Build with BPT_SINGLE_PRECISION defined for float, which halves the size of vectors and hit records
+#ifdef BPT_SINGLE_PRECISION
+using Real = float;
+#else
+using Real = double;
+#endif
+
+// Bound on the relative rounding error of n floating point operations, gamma( n ) of Higham
+constexpr Real rounding_bound( int const n )
+{
+	Real const e = std::numeric_limits<Real>::epsilon() * Real( 0.5 );
+	return ( n * e ) / ( 1 - n * e );
+};
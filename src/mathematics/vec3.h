@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "../mathematics/real.h"
+
+template<typename T>
+class Vec3 final
+{
+
+public:
+
+	T x{ 0 };
+	T y{ 0 };
+	T z{ 0 };
+
+	Vec3() {};
+
+	Vec3( T const& x, T const& y, T const& z ) : x( x ), y( y ), z( z ) {};
+
+	// Unary minus
+	Vec3 operator - () const { return Vec3( -x, -y, -z ); };
+
+	Vec3 operator + ( Vec3 const& value ) const { return Vec3( x + value.x, y + value.y, z + value.z ); };
+	Vec3 operator - ( Vec3 const& value ) const { return Vec3( x - value.x, y - value.y, z - value.z ); };
+	Vec3 operator * ( T const& value ) const { return Vec3( x * value, y * value, z * value ); };
+	Vec3 operator / ( T const& value ) const { return Vec3( x / value, y / value, z / value ); };
+
+	bool operator == ( Vec3 const& value ) const { return ( x == value.x ) && ( y == value.y ) && ( z == value.z ); };
+
+	Vec3 normalise() const { return Vec3( x, y, z ) / std::sqrt( x * x + y * y + z * z ); };
+
+	T dot( Vec3 const& value ) const { return x * value.x + y * value.y + z * value.z; };
+
+	Vec3 cross( Vec3 const& value ) const { return Vec3( y * value.z - z * value.y, z * value.x - x * value.z, x * value.y - y * value.x ); };
+
+	T magnitude() const { return std::sqrt( x * x + y * y + z * z ); };
+
+	// Component wise absolute value
+	Vec3 abs() const { return Vec3( std::abs( x ), std::abs( y ), std::abs( z ) ); };
+
+	// Component by axis, 0 = x, 1 = y, 2 = z
+	T const& operator [] ( uint8_t const& axis ) const { return axis == 0 ? x : ( axis == 1 ? y : z ); };
+
+	Vec3 static const Zero;
+	Vec3 static const One;
+	Vec3 static const X;
+	Vec3 static const Y;
+	Vec3 static const Z;
+
+};
+
+// ( 0,0,0 )
+template<typename T> Vec3<T> const Vec3<T>::Zero( 0, 0, 0 );
+// ( 1,1,1 )
+template<typename T> Vec3<T> const Vec3<T>::One( 1, 1, 1 );
+// ( 1,0,0 )
+template<typename T> Vec3<T> const Vec3<T>::X( 1, 0, 0 );
+// ( 0,1,0 )
+template<typename T> Vec3<T> const Vec3<T>::Y( 0, 1, 0 );
+// ( 0,0,1 )
+template<typename T> Vec3<T> const Vec3<T>::Z( 0, 0, 1 );
+
+// Vector of the precision chosen at compile time
+using Real3 = Vec3<Real>;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace Memory
+{
+
+	// Size of a cache line on current x86 processors
+	constexpr std::size_t cache_line{ 64 };
+
+	// Allocator for std::vector, so the first element starts on a cache line
+	template <typename T, std::size_t alignment = Memory::cache_line>
+	struct AlignedAllocator
+	{
+		using value_type = T;
+
+		template <typename U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, alignment>;
+		};
+
+		AlignedAllocator() = default;
+
+		template <typename U>
+		AlignedAllocator( AlignedAllocator<U, alignment> const& ) {};
+
+		T* allocate( std::size_t const n )
+		{
+			return static_cast<T*>( ::operator new( n * sizeof( T ), std::align_val_t( alignment ) ) );
+		};
+
+		void deallocate( T* p, std::size_t const )
+		{
+			::operator delete( p, std::align_val_t( alignment ) );
+		};
+
+		template <typename U>
+		bool operator == ( AlignedAllocator<U, alignment> const& ) const { return true; };
+
+	};
+
+};
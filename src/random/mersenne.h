@@ -1,8 +1,6 @@
 #pragma once
 
 #include <cstdint>
-#include <tuple>
-#include <utility>
 
 #include "../random/polymorphic.h"
 
@@ -27,18 +25,15 @@ namespace Random
 			: seed( seed )
 		{};
 
-		float get_float() override
-		{
-			return next() * randmaxf;
-		};
+	private:
 
-		std::tuple<float, float> get_float2() override
+		// Sequential, the block follows the previous one whatever the dimension
+		void fill() override
 		{
-			return std::tuple( next() * randmaxf, next() * randmaxf );
+			for ( float& v : value )
+				v = next() * randmaxf;
 		};
 
-	private:
-
 		inline uint32_t next()
 		{
 			uint32_t x = seed = ( 1812433253U * ( seed ^ ( seed >> 30 ) ) + 1 ) & 0xFFFFFFFFU;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../random/polymorphic.h"
+
+namespace Random
+{
+
+	// Counter based generator, the numbers of a dimension are a bijective hash of ( pixel, sample, dimension ) under the key.
+	// Nothing is carried from one number to the next, so the image does not depend on which thread traced a pixel, or when.
+	// Parallel random numbers: as easy as 1, 2, 3, 2011
+	// John K. Salmon, Mark A. Moraes, Ron O. Dror, David E. Shaw
+	class Philox final : public Random::Polymorphic
+	{
+
+	private:
+
+		uint32_t const seed{ 0 };
+
+		static constexpr uint32_t multiplier[ 2 ] = { 0xd2511f53u, 0xcd9e8d57u };
+		static constexpr uint32_t weyl[ 2 ] = { 0x9e3779b9u, 0xbb67ae85u };
+		static constexpr uint8_t rounds{ 10 };
+
+	public:
+
+		Philox() = delete;
+
+		Philox( uint32_t const& seed )
+			: seed( seed )
+		{};
+
+	private:
+
+		// Philox4x32-10 of every dimension in the block, the first two words are used
+		void fill() override
+		{
+#pragma omp simd
+			for ( uint32_t lane = 0; lane < block; ++lane )
+			{
+				uint32_t c0{ pixel };
+				uint32_t c1{ sample };
+				uint32_t c2{ first + lane };
+				uint32_t c3{ 0 };
+				uint32_t k0{ seed };
+				uint32_t k1{ 0 };
+#pragma GCC unroll 10
+				for ( uint8_t round = 0; round < rounds; ++round )
+				{
+					uint64_t const p0 = static_cast<uint64_t>( multiplier[ 0 ] ) * c0;
+					uint64_t const p1 = static_cast<uint64_t>( multiplier[ 1 ] ) * c2;
+					c0 = static_cast<uint32_t>( p1 >> 32 ) ^ c1 ^ k0;
+					c1 = static_cast<uint32_t>( p1 );
+					c2 = static_cast<uint32_t>( p0 >> 32 ) ^ c3 ^ k1;
+					c3 = static_cast<uint32_t>( p0 );
+					k0 += weyl[ 0 ];
+					k1 += weyl[ 1 ];
+				}
+				value[ 2 * lane ] = to_float( c0 );
+				value[ 2 * lane + 1 ] = to_float( c1 );
+			}
+		};
+
+		// [0, 1[
+		static float to_float( uint32_t const x )
+		{
+			return std::min( static_cast<float>( x ) * 0x1p-32f, 0x1.fffffep-1f );
+		};
+
+	};
+
+};
@@ -1,21 +1,111 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <tuple>
 #include <utility>
 
+#include "../dispatch/isa.h"
+
 namespace Random
 {
 
+	// Numbers are computed a block of dimensions at a time, by one virtual fill, so generators can work
+	// in SIMD lanes and drawing a number is an inlined read from the block.
 	class Polymorphic
 	{
 
 	public:
 
+		// Dimensions per block
+		static constexpr uint32_t block{ 8 };
+
+	protected:
+
+		// What is sampled, set by start
+		uint32_t pixel{ 0 };
+		uint32_t sample{ 0 };
+
+		// Two numbers for each of the dimensions [first, end[
+		alignas( 32 ) std::array<float, 2 * block> value{};
+		uint32_t first{ 0 };
+		uint32_t end{ 0 };
+		uint32_t current{ 0 };
+
+		// Numbers of the dimensions first to first + block
+		virtual void fill() = 0;
+
+	public:
+
+		// Where a sample is, with its buffered block, to continue it later without filling the block again
+		struct State
+		{
+			uint32_t pixel{ 0 };
+			uint32_t sample{ 0 };
+			std::array<float, 2 * block> value{};
+			uint32_t first{ 0 };
+			uint32_t end{ 0 };
+			uint32_t current{ 0 };
+		};
+
 		Polymorphic() {};
 
-		virtual float get_float() = 0;
+		virtual ~Polymorphic() = default;
+
+		FORCE_INLINE float get_float()
+		{
+			if ( current == end )
+				refill();
+			return value[ 2 * ( current++ - first ) ];
+		};
+
+		FORCE_INLINE std::tuple<float, float> get_float2()
+		{
+			if ( current == end )
+				refill();
+			uint32_t const i = 2 * ( current++ - first );
+			return { value[ i ], value[ i + 1 ] };
+		};
+
+		// Sample sample of pixel (any id of what is sampled) follows, from dimension on.
+		// Each get_float or get_float2 takes one dimension. Sequential generators ignore it.
+		void start(
+			uint32_t const& pixel,
+			uint32_t const& sample,
+			uint32_t const& dimension = 0
+		)
+		{
+			this->pixel = pixel;
+			this->sample = sample;
+			current = first = end = dimension;
+		};
+
+		// Dimension the next number comes from, to start again where a path left off
+		uint32_t dimension() const { return current; };
+
+		// Sequential generators go on from their own state, as after start
+		State state() const { return { pixel, sample, value, first, end, current }; };
+
+		void resume(
+			State const& state
+		)
+		{
+			pixel = state.pixel;
+			sample = state.sample;
+			value = state.value;
+			first = state.first;
+			end = state.end;
+			current = state.current;
+		};
+
+	private:
 
-		virtual std::tuple<float, float> get_float2() = 0;
+		void refill()
+		{
+			first = current;
+			end = current + block;
+			fill();
+		};
 
 	};
 
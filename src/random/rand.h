@@ -2,7 +2,6 @@
 
 #include <cstdint>
 #include <stdlib.h>
-#include <tuple>
 
 #include "../random/polymorphic.h"
 
@@ -20,14 +19,12 @@ namespace Random
 
 		Rand( uint32_t const& seed ) {};
 
-		float get_float() override
-		{
-			return std::rand() / static_cast<float>( RAND_MAX );
-		};
+	private:
 
-		std::tuple<float, float> get_float2() override
+		void fill() override
 		{
-			return { std::rand() / static_cast<float>( RAND_MAX ), std::rand() / static_cast<float>( RAND_MAX ) };
+			for ( float& v : value )
+				v = std::rand() / static_cast<float>( RAND_MAX );
 		};
 
 	};
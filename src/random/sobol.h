@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../random/polymorphic.h"
+
+namespace Random
+{
+
+	// Owen scrambled Sobol points, indexed by ( pixel, sample, dimension ).
+	// Every dimension (or pair, for get_float2) is the first one (two) of the Sobol sequence, with the sample index
+	// shuffled and the digits scrambled by a hash of pixel and dimension. So the samples of a pixel are stratified in
+	// every dimension and pair, and neither pixels nor dimensions are correlated.
+	// Practical hash-based Owen scrambling, 2020
+	// Brent Burley
+	class Sobol final : public Random::Polymorphic
+	{
+
+	private:
+
+		uint32_t const seed{ 0 };
+
+	public:
+
+		Sobol() = delete;
+
+		Sobol( uint32_t const& seed )
+			: seed( seed )
+		{};
+
+	private:
+
+		void fill() override
+		{
+			uint32_t const pixel_seed = hash( seed ^ hash( pixel ) );
+#pragma omp simd
+			for ( uint32_t lane = 0; lane < block; ++lane )
+			{
+				uint32_t const dimension_seed = hash( pixel_seed ^ hash( first + lane ) );
+				uint32_t const i = nested_uniform_scramble( sample, dimension_seed );
+				value[ 2 * lane ] = to_float( nested_uniform_scramble( reverse_bits( i ), combine( dimension_seed, 1 ) ) );
+				value[ 2 * lane + 1 ] = to_float( nested_uniform_scramble( sobol_1( i ), combine( dimension_seed, 2 ) ) );
+			}
+		};
+
+		// The swaps commute, byte swaps are kept apart so they are not turned into a bswap, which does not vectorise
+		static uint32_t reverse_bits( uint32_t x )
+		{
+			x = ( ( x >> 8 ) & 0x00ff00ffu ) | ( ( x & 0x00ff00ffu ) << 8 );
+			x = ( ( x >> 1 ) & 0x55555555u ) | ( ( x & 0x55555555u ) << 1 );
+			x = ( x >> 16 ) | ( x << 16 );
+			x = ( ( x >> 2 ) & 0x33333333u ) | ( ( x & 0x33333333u ) << 2 );
+			return ( ( x >> 4 ) & 0x0f0f0f0fu ) | ( ( x & 0x0f0f0f0fu ) << 4 );
+		};
+
+		// Second Sobol dimension, direction numbers v_k = v_k-1 ^ ( v_k-1 >> 1 ). The first is reverse_bits.
+		// Fixed trip count and no branches, so lanes vectorise.
+		static uint32_t sobol_1( uint32_t const i )
+		{
+			uint32_t result{ 0 };
+			uint32_t v{ 1u << 31 };
+#pragma GCC unroll 32
+			for ( uint32_t bit = 0; bit < 32; ++bit, v ^= v >> 1 )
+				result ^= v & ( 0u - ( ( i >> bit ) & 1u ) );
+			return result;
+		};
+
+		// Each bit only depends on the bits below it, so reversed it scrambles like Owen's nested permutations
+		static uint32_t laine_karras_permutation( uint32_t x, uint32_t const seed )
+		{
+			x += seed;
+			x ^= x * 0x6c50b47cu;
+			x ^= x * 0xb82f1e52u;
+			x ^= x * 0xc7afe638u;
+			x ^= x * 0x8d22f6e6u;
+			return x;
+		};
+
+		static uint32_t nested_uniform_scramble( uint32_t const x, uint32_t const seed )
+		{
+			return reverse_bits( laine_karras_permutation( reverse_bits( x ), seed ) );
+		};
+
+		// lowbias32, Chris Wellons
+		static uint32_t hash( uint32_t x )
+		{
+			x ^= x >> 16;
+			x *= 0x7feb352du;
+			x ^= x >> 15;
+			x *= 0x846ca68bu;
+			x ^= x >> 16;
+			return x;
+		};
+
+		static uint32_t combine( uint32_t const seed, uint32_t const v )
+		{
+			return seed ^ ( hash( v ) + 0x9e3779b9u + ( seed << 6 ) + ( seed >> 2 ) );
+		};
+
+		// [0, 1[
+		static float to_float( uint32_t const x )
+		{
+			return std::min( static_cast<float>( x ) * 0x1p-32f, 0x1.fffffep-1f );
+		};
+
+	};
+
+};
@@ -2,8 +2,8 @@
 
 #include <cstdint>
 
-#include "../mathematics/double3.h"
 #include "../mathematics/orthogonal.h"
+#include "../mathematics/vec3.h"
 
 namespace Ray
 {
@@ -11,11 +11,22 @@ namespace Ray
 	struct Intersection
 	{
 		// Filled by post intersection in geometry
-		Double3 normal{ 0, 0, 0 };
-		Double3 point{ 0, 0, 0 };
-		Double3 local_wray{ 0, 0, 0 };
+		Real3 normal{ 0, 0, 0 };
+		Real3 point{ 0, 0, 0 };
+		Real3 local_wray{ 0, 0, 0 };
 		Orthogonal orthogonal;
 		uint32_t material_id{ 0 };
+		// Only meaningful on emissive surfaces
+		uint32_t emitter_id{ 0 };
+		// Bound on the distance of point from the surface, from rounding in the hit computation
+		Real error{ 0 };
+
+		// Point moved off the surface by the error bound, to the side direction points to
+		// Origin of rays leaving the surface, so they can not hit it again
+		Real3 offset( Real3 const& direction ) const
+		{
+			return point + normal * ( direction.dot( normal ) < 0 ? -error : error );
+		};
 	};
 
 };
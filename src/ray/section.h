@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 
 namespace Ray
 {
@@ -10,14 +10,14 @@ namespace Ray
 
 	public:
 
-		Double3 origin;
-		Double3 direction;
+		Real3 origin;
+		Real3 direction;
 
-		Section() : origin( Double3::Zero ), direction( Double3::Z ) {};
+		Section() : origin( Real3::Zero ), direction( Real3::Z ) {};
 
 		Section(
-			Double3 const& origin,
-			Double3 const& direction
+			Real3 const& origin,
+			Real3 const& direction
 		)
 			: origin( origin ), direction( direction )
 		{};
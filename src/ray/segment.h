@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../mathematics/vec3.h"
+
+namespace Ray
+{
+
+	// Shadow ray, from an origin shared by a batch of segments
+	struct Segment
+	{
+		Real3 direction;
+		Real distance{ 0 };
+	};
+
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+#include "../dispatch/isa.h"
+#include "../integrator/bpt.h"
+#include "../render/config.h"
+
+namespace Render
+{
+
+	enum class Argument : uint8_t
+	{
+		unknown,
+		used,
+		invalid
+	};
+
+	// Largest sample count the settings hold, larger values are clamped to it
+	constexpr int max_sample_count{ std::numeric_limits<uint16_t>::max() };
+
+	// Render setting at argv[ i ], i is moved past its value.
+	// Shared by the programs that render, each handles the arguments unknown here itself.
+	inline Render::Argument parse_argument(
+		int const argc,
+		char* argv[],
+		int& i,
+		Render::Config& config
+	)
+	{
+		std::string const argument( argv[ i ] );
+		// Override the instruction set chosen from cpuid
+		if ( ( argument == "--isa" ) && ( i + 1 < argc ) )
+		{
+			std::optional<Dispatch::ISA> const isa = Dispatch::parse( argv[ ++i ] );
+			if ( !isa )
+			{
+				std::cout << "Unknown instruction set, use sse2, avx2 or avx512." << std::endl;
+				return Render::Argument::invalid;
+			}
+			if ( !Dispatch::supported( *isa ) )
+			{
+				std::cout << "Instruction set " << Dispatch::name( *isa ) << " is not supported by this processor." << std::endl;
+				return Render::Argument::invalid;
+			}
+			config.isa = *isa;
+		}
+		// Target samples per pixel, without one a time budget renders until it runs out
+		else if ( ( argument == "--samples" ) && ( i + 1 < argc ) )
+			config.max_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, Render::max_sample_count ) );
+		// Surface bounces of a path
+		else if ( ( argument == "--depth" ) && ( i + 1 < argc ) )
+			config.max_depth = static_cast<uint8_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, 255 ) );
+		// Surface bounces before paths may be ended by Russian roulette
+		else if ( ( argument == "--roulette-depth" ) && ( i + 1 < argc ) )
+			config.roulette_depth = static_cast<uint8_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, 255 ) );
+		// Samples per pixel added by each progressive pass
+		else if ( ( argument == "--pass-samples" ) && ( i + 1 < argc ) )
+			config.pass_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, Render::max_sample_count ) );
+		// Stop adding passes after this many seconds
+		else if ( ( argument == "--time" ) && ( i + 1 < argc ) )
+			config.time_budget = static_cast<float>( std::atof( argv[ ++i ] ) );
+		// Stop sampling pixels whose relative error is below this
+		else if ( ( argument == "--adaptive" ) && ( i + 1 < argc ) )
+			config.adaptive_threshold = static_cast<float>( std::atof( argv[ ++i ] ) );
+		// Samples before the error estimate of a pixel is trusted
+		else if ( ( argument == "--min-samples" ) && ( i + 1 < argc ) )
+			config.adaptive_min_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 2, Render::max_sample_count ) );
+		// Emitters a light subpath starts from
+		else if ( ( argument == "--light-samples" ) && ( i + 1 < argc ) )
+			config.light_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, 1024 ) );
+		// Emitters picked by the light tree at each camera vertex
+		else if ( ( argument == "--tree-samples" ) && ( i + 1 < argc ) )
+			config.light_tree_samples = static_cast<uint16_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, 1024 ) );
+		// Share this many light subpaths between all pixels of a pass
+		else if ( ( argument == "--light-pool" ) && ( i + 1 < argc ) )
+			config.light_pool_size = static_cast<uint32_t>( std::max( std::atoi( argv[ ++i ] ), 0 ) );
+		// Pool subpaths each camera path connects to
+		else if ( ( argument == "--pool-connections" ) && ( i + 1 < argc ) )
+			config.light_pool_connections = static_cast<uint8_t>( std::clamp( std::atoi( argv[ ++i ] ), 1, static_cast<int>( Integrator::BPT::max_pool_connections ) ) );
+		// Independent counter based random numbers instead of the Sobol sampler
+		else if ( argument == "--independent" )
+			config.f_sobol = false;
+		// Seed of the sampler
+		else if ( ( argument == "--seed" ) && ( i + 1 < argc ) )
+			config.seed = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 0 ) );
+		// Stream based integrator, currently about 10% slower than the default one
+		else if ( argument == "--wavefront" )
+			config.f_wavefront = true;
+		// Mirror tall block in the Cornell box
+		else if ( argument == "--mirror-block" )
+			config.f_mirror_block = true;
+		// Mesh placed in the Cornell box
+		else if ( ( argument == "--scene" ) && ( i + 1 < argc ) )
+			config.scene_file = argv[ ++i ];
+		// Scene cache, reused by later runs with the same input
+		else if ( ( argument == "--cache" ) && ( i + 1 < argc ) )
+			config.cache_file = argv[ ++i ];
+		else
+			return Render::Argument::unknown;
+		return Render::Argument::used;
+	};
+
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+
+#include "../dispatch/isa.h"
 
 namespace Render
 {
@@ -10,10 +13,48 @@ namespace Render
 		// Image resolution
 		uint16_t image_width{ 800 };
 		uint16_t image_height{ 800 };
-		// Samples per pixels
-		uint16_t max_samples{ 1 };
+		// Samples per pixels, the target when rendering progressively.
+		// Zero for no target, then a time budget alone ends the render, and without one a single sample is taken.
+		uint16_t max_samples{ 0 };
 		// Path length of traces, i.e. how many surface bounces
 		uint8_t max_depth{ 5 };
+		// Surface bounces before Russian roulette may end a path
+		uint8_t roulette_depth{ 3 };
+		// Edge length of the square tiles handed out to threads
+		uint16_t tile_size{ 32 };
+		// Samples per pixel added by each progressive pass
+		uint16_t pass_samples{ 1 };
+		// Relative standard error of the luminance at which a pixel stops taking samples, zero to disable
+		float adaptive_threshold{ 0.f };
+		// Samples every pixel takes before its error estimate is trusted
+		uint16_t adaptive_min_samples{ 8 };
+		// Wall clock limit of a render in seconds, zero for none
+		float time_budget{ 0.f };
+		// Emitters each light subpath starts from, picked in proportion to power when the scene has more
+		uint16_t light_samples{ 4 };
+		// Emitters picked from the light tree at each diffuse camera vertex, when light_samples does not cover them all
+		uint16_t light_tree_samples{ 1 };
+		// Light subpaths traced once per pass and shared by all pixels, zero for one per camera path
+		uint32_t light_pool_size{ 0 };
+		// Pool subpaths each camera path connects to
+		uint8_t light_pool_connections{ 4 };
+		// Owen scrambled Sobol points indexed by pixel, sample and dimension, instead of independent Philox numbers with the same indexing
+		bool f_sobol{ true };
+		// Seed of the sampler, the image only depends on it and the settings
+		uint32_t seed{ 0x1337 * 0xbeef };
+		// Trace the samples of a tile as a stream of path states, stage by stage, instead of one path at a time.
+		// Currently about 10% slower, the path states and queues cost more than the coherence gains.
+		bool f_wavefront{ false };
+		// Traverse a wide BVH with SIMD node and triangle tests, instead of the binary one, four wide in double and eight in single precision
+		bool f_wide_bvh{ true };
+		// Tall block of the Cornell box is a mirror, instead of white
+		bool f_mirror_block{ false };
+		// Mesh (.obj or binary .ply) standing in the Cornell box in place of the two blocks, empty for none
+		std::string scene_file{};
+		// Binary scene cache, read if it matches the input and settings, otherwise written after the build. Empty for none
+		std::string cache_file{};
+		// Instruction set variant of the hot kernels, best supported by default
+		Dispatch::ISA isa{ Dispatch::detect() };
 
 		Config() = default;
 
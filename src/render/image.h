@@ -1,23 +1,33 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iosfwd>
+#include <limits>
 #include <memory>
 #include <omp.h>
-#include <omp.h>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "../colour/colour.h"
 #include "../integrator/bpt.h"
+#include "../integrator/light_pool.h"
 #include "../integrator/polymorphic.h"
-#include "../random/mersenne.h"
+#include "../integrator/wavefront.h"
+#include "../random/philox.h"
 #include "../random/polymorphic.h"
+#include "../random/sobol.h"
 #include "../render/config.h"
 #include "../render/scene.h"
+#include "../render/scheduler.h"
+#include "../stats/counters.h"
+#include "../stats/trace.h"
 
 namespace Render
 {
@@ -32,8 +42,26 @@ namespace Render
 		uint16_t image_width{ 0 };
 		uint16_t image_height{ 0 };
 		uint32_t n_pixel{ 0 };
+		uint16_t tile_size{ 32 };
+
+		// Sample target, as many as the per pixel count holds when only the time budget ends the render
+		uint16_t max_samples{ 1 };
+		uint16_t pass_samples{ 1 };
+		float time_budget{ 0.f };
+		float adaptive_threshold{ 0.f };
+		uint16_t adaptive_min_samples{ 8 };
 
+		// Resolved image, running sum of all samples, and samples per pixel so far
 		std::shared_ptr<Colour[]> image_data{ nullptr };
+		std::shared_ptr<Colour[]> accumulation{ nullptr };
+		std::shared_ptr<uint16_t[]> pixel_samples{ nullptr };
+		// Running sum of squared sample luminance, for the variance estimate
+		std::shared_ptr<double[]> luminance_square{ nullptr };
+		// Pixels that still take samples
+		uint32_t n_active{ 0 };
+
+		// Hot path counts of all passes so far, all zero unless built with BPT_STATS
+		Stats::Counters counters{};
 
 		// Fix for libgdk (Linux), if it detects TGA as ICO set this to true
 		bool const f_libgdk = false;
@@ -46,32 +74,173 @@ namespace Render
 			Render::Scene const& scene,
 			Render::Config const& config
 		)
-			: image_width( config.image_width ), image_height( config.image_height ), n_pixel( config.image_width * config.image_height )
+			: image_width( config.image_width ), image_height( config.image_height ), n_pixel( config.image_width * config.image_height ), tile_size( config.tile_size ),
+			max_samples( config.max_samples > 0 ? config.max_samples : ( config.time_budget > 0.f ? std::numeric_limits<uint16_t>::max() : 1 ) ), pass_samples( std::max<uint16_t>( config.pass_samples, 1 ) ), time_budget( config.time_budget ),
+			adaptive_threshold( config.adaptive_threshold ), adaptive_min_samples( config.adaptive_min_samples )
 		{
+			BPT_TRACE_SCOPE( "image_setup" );
 			// Shared pointer, since unique_ptr can not use init value? (black)
 			image_data = std::make_shared<Colour[]>( n_pixel, Colour::Black );
-			for ( uint8_t i = 0; i < omp_get_max_threads(); ++i )
+			accumulation = std::make_shared<Colour[]>( n_pixel, Colour::Black );
+			pixel_samples = std::make_shared<uint16_t[]>( n_pixel, 0 );
+			luminance_square = std::make_shared<double[]>( n_pixel, 0. );
+
+			std::shared_ptr<Integrator::LightPool> light_pool{ nullptr };
+			if ( config.light_pool_size > 0 )
+				light_pool = std::make_shared<Integrator::LightPool>( config.light_pool_size, static_cast<uint16_t>( omp_get_max_threads() ) );
+
+			for ( uint16_t i = 0; i < omp_get_max_threads(); ++i )
 			{
-				std::unique_ptr< Random::Polymorphic > random = std::make_unique< Random::Mersenne>( ( i + 0x1337 ) * 0xbeef );
-				integrator.emplace_back( std::make_unique<Integrator::BPT>( scene, config, random ) );
+				// Numbers only depend on pixel, sample and dimension, so every thread shares the seed and the image is the same for any thread count
+				std::unique_ptr< Random::Polymorphic > random;
+				if ( config.f_sobol )
+					random = std::make_unique< Random::Sobol >( config.seed );
+				else
+					random = std::make_unique< Random::Philox >( config.seed );
+				if ( config.f_wavefront )
+					integrator.emplace_back( std::make_unique<Integrator::Wavefront>( scene, config, random, light_pool ) );
+				else
+					integrator.emplace_back( std::make_unique<Integrator::BPT>( scene, config, random, light_pool ) );
 			}
 		};
 
-		void render()
+		// Add samples pass by pass, until max_samples per pixel or the time budget is reached.
+		// With an adaptive threshold, pixels whose error estimate drops below it stop early,
+		// so later passes only trace the noisy regions.
+		// pass_done is called after each complete pass, e.g. to save an intermediate image.
+		// Returns the number of passes started, the last one may be cut short by the time budget.
+		uint32_t render(
+			std::function<void( uint32_t const& pass, uint16_t const& samples )> const& pass_done = nullptr
+		)
 		{
-			// Ignore Microsoft Visual Studio warning about omp
-#pragma warning ( suppress: 6993 )
-#pragma omp parallel for
-			// Lazy arse parallel processing. This is terrible. xD
-			for ( int y = 0; y < image_height; ++y )
-				for ( int x = 0; x < image_width; ++x )
-					image_data[ x + y * image_width ] = integrator[ omp_get_thread_num() ]->process( x, y );
+			std::chrono::steady_clock::time_point const start_time = std::chrono::steady_clock::now();
+			auto const f_expired = [ & ]()
+				{
+					return ( time_budget > 0.f ) && ( std::chrono::duration<float>( std::chrono::steady_clock::now() - start_time ).count() >= time_budget );
+				};
+
+			uint32_t pass{ 0 };
+			uint16_t samples{ 0 };
+			n_active = n_pixel;
+			std::atomic<bool> f_interrupted{ false };
+			while ( ( n_active > 0 ) && !f_interrupted && !f_expired() )
+			{
+				BPT_TRACE_SCOPE( "pass" );
+				Render::Scheduler scheduler( image_width, image_height, tile_size, static_cast<uint16_t>( integrator.size() ) );
+				std::atomic<uint32_t> n_still_active{ 0 };
+
+#pragma omp parallel
+				{
+					uint16_t const thread = static_cast<uint16_t>( omp_get_thread_num() );
+					Integrator::Polymorphic& tracer = *integrator[ thread ];
+
+					{
+						BPT_TRACE_SCOPE( "prepare_pass" );
+						tracer.prepare_pass( thread, static_cast<uint16_t>( omp_get_num_threads() ) );
+					}
+#pragma omp barrier
+
+					// Tile is accumulated locally, and written to the image once, so threads do not share cache lines while tracing
+					std::vector<Colour> tile_data( tile_size * tile_size );
+					std::vector<double> tile_square( tile_size * tile_size );
+					std::vector<uint16_t> tile_samples( tile_size * tile_size );
+					std::vector<Integrator::Sample> batch;
+					std::vector<Colour> batch_result;
+					batch.reserve( tile_size * tile_size * pass_samples );
+					batch_result.reserve( tile_size * tile_size * pass_samples );
+					uint32_t n_tile_active{ 0 };
+
+					Render::Tile tile;
+					while ( scheduler.next( thread, tile ) )
+					{
+						// A tile is either completed or not started, so each pixel stays a proper average when time runs out
+						if ( f_expired() )
+						{
+							f_interrupted = true;
+							break;
+						}
+						BPT_TRACE_TILE( "tile", tile.x0, tile.y0 );
+
+						// All samples of the tile are traced as one batch
+						batch.clear();
+						for ( uint16_t y = tile.y0; y < tile.y1; ++y )
+							for ( uint16_t x = tile.x0; x < tile.x1; ++x )
+							{
+								uint32_t const i = x + y * image_width;
+								uint32_t const t = ( x - tile.x0 ) + ( y - tile.y0 ) * tile_size;
+								uint16_t const first_sample = pixel_samples[ i ];
+								uint16_t const n_sample = f_converged( i ) ? 0 : std::min<uint16_t>( pass_samples, max_samples - first_sample );
+								for ( uint16_t s = first_sample; s < first_sample + n_sample; ++s )
+									batch.push_back( { x, y, s } );
+								tile_samples[ t ] = n_sample;
+							}
+						batch_result.resize( batch.size() );
+						tracer.process_batch( batch, batch_result.data() );
+
+						Colour const* sample = batch_result.data();
+						for ( uint16_t y = tile.y0; y < tile.y1; ++y )
+							for ( uint16_t x = tile.x0; x < tile.x1; ++x )
+							{
+								uint32_t const t = ( x - tile.x0 ) + ( y - tile.y0 ) * tile_size;
+								Colour sum( Colour::Black );
+								double square{ 0. };
+								for ( uint16_t s = 0; s < tile_samples[ t ]; ++s, ++sample )
+								{
+									sum += *sample;
+									square += static_cast<double>( sample->luminance() ) * sample->luminance();
+								}
+								tile_data[ t ] = sum;
+								tile_square[ t ] = square;
+							}
+
+						for ( uint16_t y = tile.y0; y < tile.y1; ++y )
+							for ( uint16_t x = tile.x0; x < tile.x1; ++x )
+							{
+								uint32_t const i = x + y * image_width;
+								uint32_t const t = ( x - tile.x0 ) + ( y - tile.y0 ) * tile_size;
+								if ( tile_samples[ t ] > 0 )
+								{
+									accumulation[ i ] += tile_data[ t ];
+									luminance_square[ i ] += tile_square[ t ];
+									pixel_samples[ i ] += tile_samples[ t ];
+									image_data[ i ] = accumulation[ i ] / static_cast<float>( pixel_samples[ i ] );
+								}
+								if ( !f_converged( i ) )
+									++n_tile_active;
+							}
+					}
+					n_still_active += n_tile_active;
+#ifdef BPT_STATS
+#pragma omp critical
+					counters += Stats::take();
+#endif
+				}
+
+				++pass;
+				if ( f_interrupted )
+					break;
+				n_active = n_still_active;
+				samples = std::min<uint16_t>( samples + pass_samples, max_samples );
+				if ( pass_done )
+					pass_done( pass, samples );
+			}
+
+			return pass;
 		};
 
+		// Pixels that were still taking samples after the last complete pass
+		uint32_t active_pixels() const { return n_active; };
+
+		Stats::Counters const& stats() const { return counters; };
+
+		// Linear radiance of each pixel, row by row from the top left
+		std::span<Colour const> pixels() const { return { image_data.get(), n_pixel }; };
+
 		bool save(
 			std::string const& file_name
 		)
 		{
+			BPT_TRACE_SCOPE( "save" );
 			// File output only
 			std::ofstream tga_file;
 			// If already open, delete content. Binary mode is needed
@@ -124,24 +293,47 @@ namespace Render
 				p_data[ 18 ] = 0;
 
 			// Set image, TGA uses BGR colour order
-			for ( uint32_t i = 0; i < n_pixel; ++i )
 			{
-				Colour& c = image_data[ i ];
-				uint8_t r = static_cast<uint8_t>( std::pow( std::clamp( c.r, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
-				uint8_t g = static_cast<uint8_t>( std::pow( std::clamp( c.g, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
-				uint8_t b = static_cast<uint8_t>( std::pow( std::clamp( c.b, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
-				p_data[ i * 3 + tga_header_size ] = b;
-				p_data[ i * 3 + 1 + tga_header_size ] = g;
-				p_data[ i * 3 + 2 + tga_header_size ] = r;
+				BPT_TRACE_SCOPE( "tonemap" );
+				for ( uint32_t i = 0; i < n_pixel; ++i )
+				{
+					Colour const& c = image_data[ i ];
+					p_data[ i * 3 + tga_header_size ] = static_cast<uint8_t>( std::pow( std::clamp( c.b, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
+					p_data[ i * 3 + 1 + tga_header_size ] = static_cast<uint8_t>( std::pow( std::clamp( c.g, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
+					p_data[ i * 3 + 2 + tga_header_size ] = static_cast<uint8_t>( std::pow( std::clamp( c.r, 0.f, 1.f ), 1.f / 2.2f ) * 255 );
+				}
 			}
 
 			// Dump p_data from memory to file
-			tga_file.write( (char*)( &p_data[ 0 ] ), tga_data_size );
-			tga_file.close();
+			{
+				BPT_TRACE_SCOPE( "write" );
+				tga_file.write( (char*)( &p_data[ 0 ] ), tga_data_size );
+				tga_file.close();
+			}
 
 			return true;
 		};
 
+	private:
+
+		// Pixel has all its samples, or its estimated error is below the adaptive threshold
+		bool f_converged(
+			uint32_t const& i
+		) const
+		{
+			uint16_t const n = pixel_samples[ i ];
+			if ( n >= max_samples )
+				return true;
+			if ( ( adaptive_threshold <= 0.f ) || ( n < std::max<uint16_t>( adaptive_min_samples, 2 ) ) )
+				return false;
+
+			// Standard error of the mean luminance, relative to the mean
+			// The floor keeps dark pixels from chasing noise that is invisible after tonemapping
+			double const mean = accumulation[ i ].luminance() / static_cast<double>( n );
+			double const variance = std::max( ( luminance_square[ i ] - mean * mean * n ) / ( n - 1 ), 0. );
+			return std::sqrt( variance / n ) <= adaptive_threshold * std::max( mean, 1. / 256. );
+		};
+
 	}; // end image class
 
 };
@@ -1,24 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <iostream>
 #include <memory>
+#include <span>
 #include <tuple>
 #include <vector>
 
+#include "../accelerator/bvh.h"
+#include "../accelerator/wide_bvh.h"
 #include "../bxdf/emission.h"
 #include "../bxdf/lambert.h"
 #include "../bxdf/mirror.h"
 #include "../bxdf/polymorphic.h"
 #include "../colour/colour.h"
+#include "../dispatch/isa.h"
+#include "../emitter/light_tree.h"
 #include "../emitter/polymorphic.h"
 #include "../emitter/triangle.h"
-#include "../geometry/polymorphic.h"
-#include "../geometry/triangle.h"
-#include "../mathematics/double3.h"
+#include "../geometry/mesh.h"
+#include "../loader/load.h"
+#include "../mathematics/aabb.h"
+#include "../mathematics/constant.h"
+#include "../mathematics/vec3.h"
+#include "../random/polymorphic.h"
 #include "../ray/intersection.h"
 #include "../ray/section.h"
+#include "../ray/segment.h"
 #include "../render/camera.h"
 #include "../render/config.h"
+#include "../render/scene_cache.h"
+#include "../sample/alias.h"
+#include "../stats/counters.h"
+#include "../stats/trace.h"
 
 namespace Render
 {
@@ -26,19 +43,40 @@ namespace Render
 	class Scene final
 	{
 
+	public:
+
+		// Largest number of segments in a batched occlusion query
+		static constexpr uint8_t max_batch{ 64 };
+
 	private:
 
-		std::vector< std::shared_ptr<Geometry::Polymorphic> > geometry;
+		std::shared_ptr<Geometry::Mesh> mesh{ nullptr };
 		uint32_t n_geometry{ 0 };
 
+		// Built once, shared by all copies of the scene. Only one of them is used.
+		std::shared_ptr<Accelerator::BVH const> bvh{ nullptr };
+		std::shared_ptr<Accelerator::WideBVH const> wide_bvh{ nullptr };
+
 		std::vector< std::shared_ptr<Emitter::Polymorphic> > emitter;
 		uint32_t n_emitter{ 0 };
+		// Emitters are picked in proportion to their power, n_light_sample of them per light subpath
+		Sample::Alias light_distribution;
+		uint32_t n_light_sample{ 0 };
+		// Emitters near and facing a camera vertex are picked for its shadow rays, when there are more than n_light_sample
+		std::shared_ptr<Emitter::LightTree const> light_tree{ nullptr };
+		uint16_t n_tree_sample{ 0 };
 
 		std::vector< std::shared_ptr<BxDF::Polymorphic> > bxdf;
 		uint32_t n_bxdf{ 0 };
 
 		Render::Camera camera;
 
+		// What the polymorphic objects and the camera are made from, kept for the scene cache
+		std::vector<Render::MaterialRecord> material_record;
+		std::vector<Render::EmitterRecord> emitter_record;
+		Real3 camera_position;
+		Real3 camera_target;
+
 	public:
 
 		Scene() = delete;
@@ -47,159 +85,107 @@ namespace Render
 			Render::Config const& config
 		)
 		{
-			camera = Render::Camera( Double3( -278, -800, 273 ), Double3( -278, 0, 273 ), config );
-
-			bxdf.emplace_back( std::make_shared<BxDF::Lambert>( Colour( .8f, .8f, .8f ) ) ); // White
-			bxdf.emplace_back( std::make_shared<BxDF::Lambert>( Colour( 0.6f, 0.01f, 0.01f ) ) ); // Red
-			bxdf.emplace_back( std::make_shared<BxDF::Lambert>( Colour( 0.01f, 0.25f, 0.01f ) ) ); // Green
-
-			bxdf.emplace_back( std::make_shared<BxDF::Mirror>( Colour::White ) );
-
-			// Energy is split over two equal triangles
-			Colour energy = ( Colour( 0.f, .929f, .659f ) * 8.f + Colour( 1.f, .447f, .0f ) * 15.6f + Colour( 0.376f, 0.f, 0.f ) * 18.4f ) * 0.5;
-			bxdf.emplace_back( std::make_shared<BxDF::Emission>( energy ) );
-
-			uint32_t const tall_block_material = 0; // 3 for mirror
-
-			// The Cornell Box
-			// https://www.graphics.cornell.edu/online/box/
-
-			// Note that the order, and sign, of the data is altered here, as world up is the Z axis.
-
-			// Cornell (big box)
-			Double3 const cbox[ 8 ] = {
-				Double3( 0.0, 0.0, 0.0 ),
-				Double3( 0.0, 0.0, 548.8 ),
-				Double3( 0.0, 559.2, 0.0 ),
-				Double3( 0.0, 559.2, 548.8 ),
-				Double3( -552.8, 0.0, 0.0 ),
-				Double3( -556.0, 0.0, 548.8 ),
-				Double3( -549.6, 559.2, 0.0 ),
-				Double3( -556.0, 559.2, 548.8 ),
-			};
-			// Back
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 2 ], cbox[ 3 ], cbox[ 7 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 2 ], cbox[ 7 ], cbox[ 6 ], 0 ) );
-			// Top
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 1 ], cbox[ 5 ], cbox[ 7 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 1 ], cbox[ 7 ], cbox[ 3 ], 0 ) );
-			// Bottom
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 0 ], cbox[ 2 ], cbox[ 6 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 0 ], cbox[ 6 ], cbox[ 4 ], 0 ) );
-			// Left
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 4 ], cbox[ 6 ], cbox[ 7 ], 1 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 4 ], cbox[ 7 ], cbox[ 5 ], 1 ) );
-			// Right
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 0 ], cbox[ 1 ], cbox[ 3 ], 2 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( cbox[ 0 ], cbox[ 3 ], cbox[ 2 ], 2 ) );
+			BPT_TRACE_SCOPE( "scene" );
+			mesh = std::make_shared<Geometry::Mesh>();
 
-			// Short block
-			Double3 const sbox[ 8 ] =
+			if ( config.cache_file.empty() || !read_cache( config ) )
 			{
-				Double3( -82.0, 225.0, 0.0 ),
-				Double3( -82.0, 225.0, 165.0 ),
-				Double3( -130.0, 65.0, 0.0 ),
-				Double3( -130.0, 65.0, 165.0 ),
-				Double3( -240.0, 272.0, 0.0 ),
-				Double3( -240.0, 272.0, 165.0 ),
-				Double3( -290.0, 114.0, 0.0 ),
-				Double3( -290.0, 114.0, 165.0 )
-			};
-			// Back
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 4 ], sbox[ 5 ], sbox[ 1 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 4 ], sbox[ 1 ], sbox[ 0 ], 0 ) );
-			// Front
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 2 ], sbox[ 3 ], sbox[ 7 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 2 ], sbox[ 7 ], sbox[ 6 ], 0 ) );
-			// Top
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 3 ], sbox[ 1 ], sbox[ 5 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 3 ], sbox[ 5 ], sbox[ 7 ], 0 ) );
-			// Left
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 6 ], sbox[ 7 ], sbox[ 5 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 6 ], sbox[ 5 ], sbox[ 4 ], 0 ) );
-			// Right
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 0 ], sbox[ 1 ], sbox[ 3 ], 0 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( sbox[ 0 ], sbox[ 3 ], sbox[ 2 ], 0 ) );
+				build( config );
+				if ( !config.cache_file.empty() && !write_cache( config ) )
+					std::cout << "Could not write scene cache " << config.cache_file << "." << std::endl;
+			}
 
-			// Tall block
-			Double3 const tbox[ 8 ] =
-			{
-				Double3( -265.0, 296.0, 0.0 ),
-				Double3( -265.0, 296.0, 330.0 ),
-				Double3( -314.0, 456.0, 0.0 ),
-				Double3( -314.0, 456.0, 330.0 ),
-				Double3( -423.0, 247.0, 0.0 ),
-				Double3( -423.0, 247.0, 330.0 ),
-				Double3( -472.0, 406.0, 0.0 ),
-				Double3( -472.0, 406.0, 330.0 )
-			};
-			// Back
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 6 ], tbox[ 7 ], tbox[ 3 ], tall_block_material ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 6 ], tbox[ 3 ], tbox[ 2 ], tall_block_material ) );
-			// Front
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 0 ], tbox[ 1 ], tbox[ 5 ], tall_block_material ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 0 ], tbox[ 5 ], tbox[ 4 ], tall_block_material ) );
-			// Top
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 5 ], tbox[ 1 ], tbox[ 3 ], tall_block_material ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 5 ], tbox[ 3 ], tbox[ 7 ], tall_block_material ) );
-			// Left
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 4 ], tbox[ 5 ], tbox[ 7 ], tall_block_material ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 4 ], tbox[ 7 ], tbox[ 6 ], tall_block_material ) );
-			// Right
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 2 ], tbox[ 3 ], tbox[ 1 ], tall_block_material ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( tbox[ 2 ], tbox[ 1 ], tbox[ 0 ], tall_block_material ) );
-
-			// Offset to avoid "z fighting"
-			Double3 const light[ 4 ] =
-			{
-				Double3( -213.0, 227.0, 548.8 - 0.01 ),
-				Double3( -213.0, 332.0, 548.8 - 0.01 ),
-				Double3( -343.0, 227.0, 548.8 - 0.01 ),
-				Double3( -343.0, 332.0, 548.8 - 0.01 ),
-			};
-			// Visible emitters
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( light[ 2 ], light[ 3 ], light[ 1 ], 4 ) );
-			geometry.emplace_back( std::make_shared<Geometry::Triangle>( light[ 2 ], light[ 1 ], light[ 0 ], 4 ) );
-			// Emitters
-			emitter.emplace_back( std::make_shared<Emitter::Triangle>( light[ 2 ], light[ 3 ], light[ 1 ], energy ) );
-			emitter.emplace_back( std::make_shared<Emitter::Triangle>( light[ 2 ], light[ 1 ], light[ 0 ], energy ) );
+			camera = Render::Camera( camera_position, camera_target, config );
 
 			// Update
-			n_geometry = static_cast<uint32_t>( geometry.size() );
+			n_geometry = mesh->size();
 			n_emitter = static_cast<uint32_t>( emitter.size() );
 			n_bxdf = static_cast<uint32_t>( bxdf.size() );
-		};
 
-		std::tuple<bool, double, Ray::Intersection> intersect( Ray::Section const& ray ) const
-		{
-			double distance = 1e20;
-			uint32_t object_id = 0;
-			for ( uint32_t i = 0; i < n_geometry; ++i )
+			std::vector<double> power;
+			power.reserve( n_emitter );
+			for ( std::shared_ptr<Emitter::Polymorphic> const& e : emitter )
+				power.push_back( e->power() );
+			light_distribution = Sample::Alias( power );
+			n_light_sample = std::min<uint32_t>( n_emitter, config.light_samples );
+			if ( n_emitter > n_light_sample )
 			{
-				double d = geometry[ i ]->intersect( ray );
-				if ( d > 0.0 && d < distance )
-				{
-					distance = d;
-					object_id = i;
-				}
+				light_tree = std::make_shared<Emitter::LightTree const>( emitter );
+				n_tree_sample = std::max<uint16_t>( config.light_tree_samples, 1 );
 			}
+		};
 
-			if ( distance >= 1e19 )
+		std::tuple<bool, Real, Ray::Intersection> intersect( Ray::Section const& ray ) const
+		{
+			BPT_STAT( intersect_rays, 1 );
+			auto const [f_hit, distance, object_id] = wide_bvh ? wide_bvh->intersect( ray, 1e20 ) : bvh->intersect( *mesh, ray, 1e20 );
+			if ( !f_hit )
 				return { false, {}, {} };
 
-			auto idata = geometry[ object_id ]->post_intersect( ray, distance );
+			auto idata = mesh->post_intersect( ray, distance, object_id );
 			return { true, distance, idata };
 		};
 
-		bool occluded( Ray::Section const& ray, double const& distance ) const
+		// Packet of rays from a shared origin, at most max_batch, e.g. primary rays of the camera
+		// Bit i of the result is set when ray i hit, its intersection is written to idata[ i ], and its distance to hit_distance[ i ] if given
+		uint64_t intersect(
+			Real3 const& origin,
+			Real3 const* direction,
+			uint8_t const& count,
+			Ray::Intersection* idata,
+			Real* hit_distance = nullptr
+		) const
 		{
-			for ( uint32_t i = 0; i < n_geometry; ++i )
+			BPT_STAT( intersect_rays, count );
+			std::array<Real, max_batch> distance;
+			std::array<uint32_t, max_batch> object_id;
+			distance.fill( 1e20 );
+
+			uint64_t f_hit{ 0 };
+			if ( wide_bvh )
+				f_hit = wide_bvh->intersect( origin, direction, count, distance.data(), object_id.data() );
+			else
+				for ( uint8_t i = 0; i < count; ++i )
+				{
+					bool f_ray_hit{ false };
+					std::tie( f_ray_hit, distance[ i ], object_id[ i ] ) = bvh->intersect( *mesh, Ray::Section( origin, direction[ i ] ), 1e20 );
+					if ( f_ray_hit )
+						f_hit |= 1ull << i;
+				}
+
+			for ( uint64_t bits = f_hit; bits; bits &= bits - 1 )
 			{
-				double d = geometry[ i ]->intersect( ray );
-				if ( d > 0.0 && d < distance )
-					return true;
+				uint8_t const i = static_cast<uint8_t>( std::countr_zero( bits ) );
+				idata[ i ] = mesh->post_intersect( Ray::Section( origin, direction[ i ] ), distance[ i ], object_id[ i ] );
+				if ( hit_distance )
+					hit_distance[ i ] = static_cast<Real>( distance[ i ] );
 			}
-			return false;
+			return f_hit;
+		};
+
+		bool occluded( Ray::Section const& ray, Real const& distance ) const
+		{
+			BPT_STAT( occluded_rays, 1 );
+			return wide_bvh ? wide_bvh->occluded( ray, distance ) : bvh->occluded( *mesh, ray, distance );
+		};
+
+		// Batch of shadow rays from a shared origin, at most max_batch
+		// Bit i of the result is set when segment i is occluded
+		uint64_t occluded(
+			Real3 const& origin,
+			Ray::Segment const* segment,
+			uint8_t const& count
+		) const
+		{
+			BPT_STAT( occluded_rays, count );
+			if ( wide_bvh )
+				return wide_bvh->occluded( origin, segment, count );
+
+			uint64_t result{ 0 };
+			for ( uint8_t i = 0; i < count; ++i )
+				if ( bvh->occluded( *mesh, Ray::Section( origin, segment[ i ].direction ), segment[ i ].distance ) )
+					result |= 1ull << i;
+			return result;
 		};
 
 		BxDF::Polymorphic const* material( uint32_t const& id ) const
@@ -218,17 +204,326 @@ namespace Render
 			return *emitter[ id ];
 		};
 
+		// Emitter of the j-th start of a light subpath, j < n_light_samples(), and the weight of its emission.
+		// With no more emitters than samples each is used once, otherwise they are picked by power,
+		// and weighted by 1 / ( samples * pdf ), so the starts still estimate the total emission.
+		std::tuple<uint32_t, float> pick_light(
+			uint32_t const& j,
+			Random::Polymorphic& random
+		) const
+		{
+			if ( n_emitter <= n_light_sample )
+				return { j, 1.f };
+			auto const [id, pdf] = light_distribution.sample( random.get_float() );
+			return { id, 1.f / ( static_cast<float>( n_light_sample ) * pdf ) };
+		};
+
+		// Emitter for a shadow ray from point, on a surface facing normal, picked by the light tree.
+		// Returns the weight of its contribution, 1 / ( samples * pdf ), zero if no emitter can light the point.
+		std::tuple<uint32_t, float> pick_light(
+			Real3 const& point,
+			Real3 const& normal,
+			Random::Polymorphic& random
+		) const
+		{
+			auto const [id, pdf] = light_tree->sample( point, normal, random.get_float() );
+			if ( pdf <= 0.f )
+				return { 0, 0.f };
+			return { id, 1.f / ( static_cast<float>( n_tree_sample ) * pdf ) };
+		};
+
+		// Area pdf of the starts of the light subpaths on emitter id, all starts together
+		FORCE_INLINE float start_pdf(
+			uint32_t const& id
+		) const
+		{
+			if ( n_emitter <= n_light_sample )
+				return light( id ).pdf_area();
+			return static_cast<float>( n_light_sample ) * light_distribution.pdf( id ) * light( id ).pdf_area();
+		};
+
+		// Area pdf of the emitter connections from point, on a surface facing normal, to emitter id.
+		// Picked by the light tree, or the starts of the light subpaths.
+		float direct_pdf(
+			uint32_t const& id,
+			Real3 const& point,
+			Real3 const& normal
+		) const
+		{
+			if ( !light_tree )
+				return start_pdf( id );
+			return static_cast<float>( n_tree_sample ) * light_tree->pdf( point, normal, id ) * light( id ).pdf_area();
+		};
+
 		Ray::Section camera_ray(
 			uint16_t const& x,
 			uint16_t const& y,
-			uint16_t const& sample
+			Random::Polymorphic& random
 		) const
 		{
-			return camera.generate_ray( x, y, sample );
+			return camera.generate_ray( x, y, random );
 		};
 
 		uint32_t n_object() const { return n_geometry; };
 		uint32_t n_light() const { return n_emitter; };
+		uint32_t n_light_samples() const { return n_light_sample; };
+		// Shadow rays per camera vertex picked by the light tree, zero when the light subpath starts cover all emitters
+		uint16_t n_tree_samples() const { return n_tree_sample; };
+		uint32_t n_material() const { return n_bxdf; };
+
+	private:
+
+		// The Cornell box, with the mesh of config.scene_file in place of the blocks if given
+		void build(
+			Render::Config const& config
+		)
+		{
+			camera_position = Real3( -278, -800, 273 );
+			camera_target = Real3( -278, 0, 273 );
+
+			add_material( { Render::MaterialType::lambert, Colour( .8f, .8f, .8f ) } ); // White
+			add_material( { Render::MaterialType::lambert, Colour( 0.6f, 0.01f, 0.01f ) } ); // Red
+			add_material( { Render::MaterialType::lambert, Colour( 0.01f, 0.25f, 0.01f ) } ); // Green
+
+			add_material( { Render::MaterialType::mirror, Colour::White } );
+
+			// Energy is split over two equal triangles
+			// Times pi, as Lambert reflects albedo / pi, so the box is as bright as with the original unnormalised Lambert
+			Colour energy = ( Colour( 0.f, .929f, .659f ) * 8.f + Colour( 1.f, .447f, .0f ) * 15.6f + Colour( 0.376f, 0.f, 0.f ) * 18.4f ) * ( 0.5f * pi );
+			add_material( { Render::MaterialType::emission, energy } );
+
+			uint32_t const tall_block_material = config.f_mirror_block ? 3 : 0;
+
+			// Names a mesh file can refer to the materials above by
+			Loader::Options load_options;
+			load_options.material_name = { "white", "red", "green", "mirror", "light" };
+			// Floor area between the walls, as high as the tall block
+			load_options.fit = AABB( Real3( -500.0, 50.0, 0.0 ), Real3( -60.0, 510.0, 330.0 ) );
+
+			// The Cornell Box
+			// https://www.graphics.cornell.edu/online/box/
+
+			// Note that the order, and sign, of the data is altered here, as world up is the Z axis.
+
+			// Cornell (big box)
+			Real3 const cbox[ 8 ] = {
+				Real3( 0.0, 0.0, 0.0 ),
+				Real3( 0.0, 0.0, 548.8 ),
+				Real3( 0.0, 559.2, 0.0 ),
+				Real3( 0.0, 559.2, 548.8 ),
+				Real3( -552.8, 0.0, 0.0 ),
+				Real3( -556.0, 0.0, 548.8 ),
+				Real3( -549.6, 559.2, 0.0 ),
+				Real3( -556.0, 559.2, 548.8 ),
+			};
+			// Back
+			mesh->add( cbox[ 2 ], cbox[ 3 ], cbox[ 7 ], 0 );
+			mesh->add( cbox[ 2 ], cbox[ 7 ], cbox[ 6 ], 0 );
+			// Top
+			mesh->add( cbox[ 1 ], cbox[ 5 ], cbox[ 7 ], 0 );
+			mesh->add( cbox[ 1 ], cbox[ 7 ], cbox[ 3 ], 0 );
+			// Bottom
+			mesh->add( cbox[ 0 ], cbox[ 2 ], cbox[ 6 ], 0 );
+			mesh->add( cbox[ 0 ], cbox[ 6 ], cbox[ 4 ], 0 );
+			// Left
+			mesh->add( cbox[ 4 ], cbox[ 6 ], cbox[ 7 ], 1 );
+			mesh->add( cbox[ 4 ], cbox[ 7 ], cbox[ 5 ], 1 );
+			// Right
+			mesh->add( cbox[ 0 ], cbox[ 1 ], cbox[ 3 ], 2 );
+			mesh->add( cbox[ 0 ], cbox[ 3 ], cbox[ 2 ], 2 );
+
+			uint32_t const first_loaded = mesh->size();
+			bool f_blocks = config.scene_file.empty();
+			if ( !f_blocks && !Loader::load( config.scene_file, *mesh, load_options ) )
+			{
+				std::cout << "Could not load " << config.scene_file << ", using the default blocks." << std::endl;
+				f_blocks = true;
+			}
+			// Faces of the mesh made of light are emitters too, degenerate ones emit nothing
+			for ( uint32_t i = first_loaded; i < mesh->size(); ++i )
+				if ( ( mesh->shadings()[ i ].material_id == 4 ) && ( ( *mesh )[ i ].edge1.cross( ( *mesh )[ i ].edge2 ).magnitude() > 0. ) )
+				{
+					Geometry::Triangle const& t = ( *mesh )[ i ];
+					add_emitter( { t.position, t.position + t.edge1, t.position + t.edge2, energy } );
+					mesh->set_emitter( i, static_cast<uint32_t>( emitter.size() - 1 ) );
+				}
+
+			if ( f_blocks )
+			{
+				// Short block
+				Real3 const sbox[ 8 ] =
+				{
+					Real3( -82.0, 225.0, 0.0 ),
+					Real3( -82.0, 225.0, 165.0 ),
+					Real3( -130.0, 65.0, 0.0 ),
+					Real3( -130.0, 65.0, 165.0 ),
+					Real3( -240.0, 272.0, 0.0 ),
+					Real3( -240.0, 272.0, 165.0 ),
+					Real3( -290.0, 114.0, 0.0 ),
+					Real3( -290.0, 114.0, 165.0 )
+				};
+				// Back
+				mesh->add( sbox[ 4 ], sbox[ 5 ], sbox[ 1 ], 0 );
+				mesh->add( sbox[ 4 ], sbox[ 1 ], sbox[ 0 ], 0 );
+				// Front
+				mesh->add( sbox[ 2 ], sbox[ 3 ], sbox[ 7 ], 0 );
+				mesh->add( sbox[ 2 ], sbox[ 7 ], sbox[ 6 ], 0 );
+				// Top
+				mesh->add( sbox[ 3 ], sbox[ 1 ], sbox[ 5 ], 0 );
+				mesh->add( sbox[ 3 ], sbox[ 5 ], sbox[ 7 ], 0 );
+				// Left
+				mesh->add( sbox[ 6 ], sbox[ 7 ], sbox[ 5 ], 0 );
+				mesh->add( sbox[ 6 ], sbox[ 5 ], sbox[ 4 ], 0 );
+				// Right
+				mesh->add( sbox[ 0 ], sbox[ 1 ], sbox[ 3 ], 0 );
+				mesh->add( sbox[ 0 ], sbox[ 3 ], sbox[ 2 ], 0 );
+
+				// Tall block
+				Real3 const tbox[ 8 ] =
+				{
+					Real3( -265.0, 296.0, 0.0 ),
+					Real3( -265.0, 296.0, 330.0 ),
+					Real3( -314.0, 456.0, 0.0 ),
+					Real3( -314.0, 456.0, 330.0 ),
+					Real3( -423.0, 247.0, 0.0 ),
+					Real3( -423.0, 247.0, 330.0 ),
+					Real3( -472.0, 406.0, 0.0 ),
+					Real3( -472.0, 406.0, 330.0 )
+				};
+				// Back
+				mesh->add( tbox[ 6 ], tbox[ 7 ], tbox[ 3 ], tall_block_material );
+				mesh->add( tbox[ 6 ], tbox[ 3 ], tbox[ 2 ], tall_block_material );
+				// Front
+				mesh->add( tbox[ 0 ], tbox[ 1 ], tbox[ 5 ], tall_block_material );
+				mesh->add( tbox[ 0 ], tbox[ 5 ], tbox[ 4 ], tall_block_material );
+				// Top
+				mesh->add( tbox[ 5 ], tbox[ 1 ], tbox[ 3 ], tall_block_material );
+				mesh->add( tbox[ 5 ], tbox[ 3 ], tbox[ 7 ], tall_block_material );
+				// Left
+				mesh->add( tbox[ 4 ], tbox[ 5 ], tbox[ 7 ], tall_block_material );
+				mesh->add( tbox[ 4 ], tbox[ 7 ], tbox[ 6 ], tall_block_material );
+				// Right
+				mesh->add( tbox[ 2 ], tbox[ 3 ], tbox[ 1 ], tall_block_material );
+				mesh->add( tbox[ 2 ], tbox[ 1 ], tbox[ 0 ], tall_block_material );
+			}
+
+			// Offset to avoid "z fighting"
+			Real3 const light[ 4 ] =
+			{
+				Real3( -213.0, 227.0, 548.8 - 0.01 ),
+				Real3( -213.0, 332.0, 548.8 - 0.01 ),
+				Real3( -343.0, 227.0, 548.8 - 0.01 ),
+				Real3( -343.0, 332.0, 548.8 - 0.01 ),
+			};
+			// Visible emitters
+			mesh->add( light[ 2 ], light[ 3 ], light[ 1 ], 4 );
+			mesh->add( light[ 2 ], light[ 1 ], light[ 0 ], 4 );
+			// Emitters
+			add_emitter( { light[ 2 ], light[ 3 ], light[ 1 ], energy } );
+			mesh->set_emitter( mesh->size() - 2, static_cast<uint32_t>( emitter.size() - 1 ) );
+			add_emitter( { light[ 2 ], light[ 1 ], light[ 0 ], energy } );
+			mesh->set_emitter( mesh->size() - 1, static_cast<uint32_t>( emitter.size() - 1 ) );
+
+			bvh = std::make_shared<Accelerator::BVH const>( *mesh );
+			// Leaves refer to contiguous ranges of triangles
+			mesh->reorder( bvh->primitive_ids() );
+			if ( config.f_wide_bvh )
+			{
+				wide_bvh = std::make_shared<Accelerator::WideBVH const>( *bvh, *mesh, config.isa );
+				bvh = nullptr;
+			}
+		};
+
+
+		void add_material(
+			Render::MaterialRecord const& record
+		)
+		{
+			material_record.push_back( record );
+			switch ( record.type )
+			{
+			case Render::MaterialType::mirror:
+				bxdf.emplace_back( std::make_shared<BxDF::Mirror>( record.colour ) );
+				break;
+			case Render::MaterialType::emission:
+				bxdf.emplace_back( std::make_shared<BxDF::Emission>( record.colour ) );
+				break;
+			default:
+				bxdf.emplace_back( std::make_shared<BxDF::Lambert>( record.colour ) );
+				break;
+			}
+		};
+
+		void add_emitter(
+			Render::EmitterRecord const& record
+		)
+		{
+			emitter_record.push_back( record );
+			emitter.emplace_back( std::make_shared<Emitter::Triangle>( record.a, record.b, record.c, record.energy ) );
+		};
+
+		// Restore everything build makes from a cache written for the same input and settings
+		bool read_cache(
+			Render::Config const& config
+		)
+		{
+			Render::SceneCache::Reader const cache( config.cache_file );
+			if ( !cache.f_valid( config ) )
+				return false;
+
+			Render::SceneCache::Header const& header = cache.header;
+			auto const material_data = cache.section<Render::MaterialRecord>( header.material );
+			auto const emitter_data = cache.section<Render::EmitterRecord>( header.emitter );
+			auto const triangle_data = cache.section<Geometry::Triangle>( header.triangle );
+			auto const shading_data = cache.section<Geometry::Shading>( header.shading );
+			auto const bvh_data = cache.section<Accelerator::BVH::Node>( header.bvh_node );
+			auto const wide_data = cache.section<Accelerator::WideBVH::Node>( header.wide_node );
+			auto const packet_data = cache.section<Accelerator::WideBVH::Packet>( header.packet );
+			// A truncated file yields shorter sections than the header promises
+			if ( ( material_data.size() != header.material.count ) || ( emitter_data.size() != header.emitter.count )
+				|| ( triangle_data.size() != header.triangle.count ) || ( shading_data.size() != header.triangle.count )
+				|| ( bvh_data.size() != header.bvh_node.count ) || ( wide_data.size() != header.wide_node.count ) || ( packet_data.size() != header.packet.count ) )
+				return false;
+
+			camera_position = header.camera_position;
+			camera_target = header.camera_target;
+			for ( Render::MaterialRecord const& record : material_data )
+				add_material( record );
+			for ( Render::EmitterRecord const& record : emitter_data )
+				add_emitter( record );
+			mesh->assign( triangle_data, shading_data );
+			if ( config.f_wide_bvh )
+				wide_bvh = std::make_shared<Accelerator::WideBVH const>( wide_data, packet_data, config.isa );
+			else
+				bvh = std::make_shared<Accelerator::BVH const>( bvh_data );
+
+			std::cout << "Scene read from cache " << config.cache_file << "." << std::endl;
+			return true;
+		};
+
+		bool write_cache(
+			Render::Config const& config
+		) const
+		{
+			Render::SceneCache::Writer cache( config.cache_file );
+			Render::SceneCache::Header& header = cache.header;
+			header.f_wide_bvh = config.f_wide_bvh ? 1 : 0;
+			header.source_key = Render::SceneCache::source_key( config );
+			header.camera_position = camera_position;
+			header.camera_target = camera_target;
+			header.material = cache.add( std::span<Render::MaterialRecord const>( material_record ) );
+			header.emitter = cache.add( std::span<Render::EmitterRecord const>( emitter_record ) );
+			header.triangle = cache.add( mesh->triangles() );
+			header.shading = cache.add( mesh->shadings() );
+			if ( wide_bvh )
+			{
+				header.wide_node = cache.add( wide_bvh->nodes() );
+				header.packet = cache.add( wide_bvh->packets() );
+			}
+			else
+				header.bvh_node = cache.add( std::span<Accelerator::BVH::Node const>( bvh->nodes() ) );
+			return cache.close();
+		};
 
 	};
 
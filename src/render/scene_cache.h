@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../colour/colour.h"
+#include "../loader/mapped_file.h"
+#include "../mathematics/real.h"
+#include "../mathematics/vec3.h"
+#include "../memory/aligned_allocator.h"
+#include "../render/config.h"
+
+namespace Render
+{
+
+	enum class MaterialType : uint32_t
+	{
+		lambert,
+		mirror,
+		emission
+	};
+
+	// Plain description of a material, the scene makes its BxDF from it, and the cache stores it
+	struct MaterialRecord
+	{
+		Render::MaterialType type{ Render::MaterialType::lambert };
+		Colour colour;
+	};
+
+	// Plain description of a triangle emitter
+	struct EmitterRecord
+	{
+		Real3 a;
+		Real3 b;
+		Real3 c;
+		Colour energy;
+	};
+
+	// Versioned binary image of a built scene: materials, emitters, triangles in leaf order,
+	// camera and acceleration structure. The file is memory mapped and its sections copied
+	// straight into place, so a cached scene starts with no parsing and no BVH build.
+	namespace SceneCache
+	{
+
+		// Increment whenever the layout, or the way the built in scene is made, changes
+		constexpr uint32_t version{ 5 };
+
+		constexpr char magic[ 8 ] = { 'B', 'P', 'T', 'S', 'C', 'E', 'N', 'E' };
+
+		// Array of count elements, offset is from the start of the file and cache line aligned
+		struct Section
+		{
+			uint64_t offset{ 0 };
+			uint64_t count{ 0 };
+		};
+
+		struct Header
+		{
+			char magic[ 8 ]{};
+			uint32_t version{ 0 };
+			// The cache is only valid for the same precision, BVH kind and input
+			uint32_t real_size{ 0 };
+			uint32_t f_wide_bvh{ 0 };
+			uint64_t source_key{ 0 };
+
+			Real3 camera_position;
+			Real3 camera_target;
+
+			Section material;
+			Section emitter;
+			Section triangle;
+			Section shading;
+			// Binary BVH nodes, or wide nodes and triangle packets
+			Section bvh_node;
+			Section wide_node;
+			Section packet;
+		};
+
+		// Identifies the input of the scene, FNV-1a of the block material, and the mesh file name, size and modification time
+		inline uint64_t source_key(
+			Render::Config const& config
+		)
+		{
+			uint64_t key{ 14695981039346656037ull };
+			auto const hash = [ &key ]( void const* data, size_t const size )
+				{
+					for ( size_t i = 0; i < size; ++i )
+						key = ( key ^ static_cast<uint8_t const*>( data )[ i ] ) * 1099511628211ull;
+				};
+
+			uint8_t const f_mirror_block = config.f_mirror_block ? 1 : 0;
+			hash( &f_mirror_block, sizeof( f_mirror_block ) );
+			hash( config.scene_file.data(), config.scene_file.size() );
+			struct stat status;
+			if ( !config.scene_file.empty() && ( ::stat( config.scene_file.c_str(), &status ) == 0 ) )
+			{
+				int64_t const size = status.st_size;
+				int64_t const time[ 2 ] = { status.st_mtim.tv_sec, status.st_mtim.tv_nsec };
+				hash( &size, sizeof( size ) );
+				hash( time, sizeof( time ) );
+			}
+			return key;
+		};
+
+		// Sections are appended in order, the header is written last, once all offsets are known.
+		// Output goes to a temporary file that is renamed into place, so concurrent jobs never map a partial cache.
+		class Writer final
+		{
+
+		private:
+
+			std::string file_name;
+			std::string temporary_name;
+			std::ofstream file;
+			uint64_t offset{ 0 };
+
+		public:
+
+			Header header;
+
+			Writer() = delete;
+
+			Writer(
+				std::string const& file_name
+			)
+				: file_name( file_name ), temporary_name( file_name + ".tmp" + std::to_string( ::getpid() ) )
+			{
+				file.open( temporary_name, std::ios::trunc | std::ios::binary );
+				std::memcpy( header.magic, SceneCache::magic, sizeof( header.magic ) );
+				header.version = SceneCache::version;
+				header.real_size = sizeof( Real );
+				pad( sizeof( Header ) );
+			};
+
+			template<typename T>
+			Section add(
+				std::span<T const> const& data
+			)
+			{
+				static_assert( std::is_standard_layout_v<T> );
+				Section const section{ offset, data.size() };
+				pad( data.size_bytes(), reinterpret_cast<char const*>( data.data() ) );
+				return section;
+			};
+
+			// Writes the header and moves the file into place
+			bool close()
+			{
+				file.seekp( 0 );
+				file.write( reinterpret_cast<char const*>( &header ), sizeof( Header ) );
+				file.close();
+				if ( !file )
+				{
+					std::remove( temporary_name.c_str() );
+					return false;
+				}
+				return std::rename( temporary_name.c_str(), file_name.c_str() ) == 0;
+			};
+
+		private:
+
+			// Write size bytes of data, zeros if null, then pad to the next cache line
+			void pad(
+				size_t const size,
+				char const* data = nullptr
+			)
+			{
+				if ( data )
+					file.write( data, size );
+				else
+					for ( size_t i = 0; i < size; ++i )
+						file.put( 0 );
+				offset += size;
+				while ( offset % Memory::cache_line )
+				{
+					file.put( 0 );
+					++offset;
+				}
+			};
+
+		};
+
+		// Maps a cache and checks its header against the current build, sections are then views into the file
+		class Reader final
+		{
+
+		private:
+
+			Loader::MappedFile file;
+
+		public:
+
+			Header header;
+
+			Reader() = delete;
+
+			Reader(
+				std::string const& file_name
+			)
+				: file( file_name )
+			{
+				if ( file.f_valid() && ( file.size() >= sizeof( Header ) ) )
+					std::memcpy( &header, file.data(), sizeof( Header ) );
+			};
+
+			bool f_valid(
+				Render::Config const& config
+			) const
+			{
+				return ( std::memcmp( header.magic, SceneCache::magic, sizeof( header.magic ) ) == 0 )
+					&& ( header.version == SceneCache::version )
+					&& ( header.real_size == sizeof( Real ) )
+					&& ( header.f_wide_bvh == ( config.f_wide_bvh ? 1u : 0u ) )
+					&& ( header.source_key == SceneCache::source_key( config ) );
+			};
+
+			// Empty if the section does not lie within the file
+			template<typename T>
+			std::span<T const> section(
+				Section const& s
+			) const
+			{
+				if ( ( s.offset % Memory::cache_line ) || ( s.offset > file.size() ) || ( s.count > ( file.size() - s.offset ) / sizeof( T ) ) )
+					return {};
+				return std::span<T const>( reinterpret_cast<T const*>( file.data() + s.offset ), s.count );
+			};
+
+		};
+
+	};
+
+};
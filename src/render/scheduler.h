@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../memory/aligned_allocator.h"
+
+namespace Render
+{
+
+	// Pixel rectangle [x0, x1[ x [y0, y1[
+	struct Tile
+	{
+		uint16_t x0{ 0 };
+		uint16_t y0{ 0 };
+		uint16_t x1{ 0 };
+		uint16_t y1{ 0 };
+
+		uint16_t width() const { return x1 - x0; };
+		uint16_t height() const { return y1 - y0; };
+	};
+
+	// Hands out image tiles to threads.
+	// Tiles are visited in Morton order, and each thread starts with its own contiguous run of them,
+	// so neighbouring tiles (and their geometry) stay on one core. A thread that runs out of work
+	// steals from the far end of another thread's queue, so no core idles while tiles remain.
+	class Scheduler final
+	{
+
+	private:
+
+		// One per thread, on its own cache line to avoid false sharing of the locks
+		struct alignas( Memory::cache_line ) Queue
+		{
+			std::mutex lock;
+			std::deque<Render::Tile> tile;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queue;
+
+	public:
+
+		Scheduler() = delete;
+
+		Scheduler(
+			uint16_t const& image_width,
+			uint16_t const& image_height,
+			uint16_t const& tile_size,
+			uint16_t const& n_thread
+		)
+		{
+			uint16_t const n_x = ( image_width + tile_size - 1 ) / tile_size;
+			uint16_t const n_y = ( image_height + tile_size - 1 ) / tile_size;
+
+			std::vector<std::pair<uint32_t, Render::Tile>> ordered;
+			ordered.reserve( n_x * n_y );
+			for ( uint16_t ty = 0; ty < n_y; ++ty )
+				for ( uint16_t tx = 0; tx < n_x; ++tx )
+				{
+					Render::Tile const tile{
+						static_cast<uint16_t>( tx * tile_size ),
+						static_cast<uint16_t>( ty * tile_size ),
+						static_cast<uint16_t>( std::min<uint32_t>( ( tx + 1 ) * tile_size, image_width ) ),
+						static_cast<uint16_t>( std::min<uint32_t>( ( ty + 1 ) * tile_size, image_height ) ) };
+					ordered.push_back( { morton( tx, ty ), tile } );
+				}
+			std::sort( std::begin( ordered ), std::end( ordered ), []( auto const& a, auto const& b ) { return a.first < b.first; } );
+
+			uint16_t const n_queue = std::max<uint16_t>( n_thread, 1 );
+			for ( uint16_t i = 0; i < n_queue; ++i )
+				queue.emplace_back( std::make_unique<Queue>() );
+
+			// Contiguous runs, the first threads get one tile more if it does not divide evenly
+			std::size_t begin{ 0 };
+			for ( uint16_t i = 0; i < n_queue; ++i )
+			{
+				std::size_t const end = begin + ordered.size() / n_queue + ( i < ordered.size() % n_queue ? 1 : 0 );
+				for ( std::size_t j = begin; j < end; ++j )
+					queue[ i ]->tile.push_back( ordered[ j ].second );
+				begin = end;
+			}
+		};
+
+		// Next tile for thread, false when all tiles are taken
+		bool next(
+			uint16_t const& thread,
+			Render::Tile& tile
+		)
+		{
+			// Own queue, from the front
+			{
+				Queue& own = *queue[ thread % queue.size() ];
+				std::lock_guard<std::mutex> guard( own.lock );
+				if ( !own.tile.empty() )
+				{
+					tile = own.tile.front();
+					own.tile.pop_front();
+					return true;
+				}
+			}
+
+			// Steal from the back of the other queues
+			for ( std::size_t i = 1; i < queue.size(); ++i )
+			{
+				Queue& victim = *queue[ ( thread + i ) % queue.size() ];
+				std::lock_guard<std::mutex> guard( victim.lock );
+				if ( !victim.tile.empty() )
+				{
+					tile = victim.tile.back();
+					victim.tile.pop_back();
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+	private:
+
+		// Interleave the bits of x and y, z-order curve
+		static uint32_t morton(
+			uint16_t const& x,
+			uint16_t const& y
+		)
+		{
+			auto spread = []( uint32_t v ) -> uint32_t
+				{
+					v = ( v | ( v << 8 ) ) & 0x00FF00FFU;
+					v = ( v | ( v << 4 ) ) & 0x0F0F0F0FU;
+					v = ( v | ( v << 2 ) ) & 0x33333333U;
+					v = ( v | ( v << 1 ) ) & 0x55555555U;
+					return v;
+				};
+			return spread( x ) | ( spread( y ) << 1 );
+		};
+
+	};
+
+};
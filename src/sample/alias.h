@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace Sample
+{
+
+	// Discrete distribution over weighted items, sampled in constant time.
+	// Vose's alias method: each bin holds one item with probability threshold, else its alias.
+	class Alias final
+	{
+
+	private:
+
+		struct Bin
+		{
+			float threshold{ 1.f };
+			uint32_t alias{ 0 };
+			// Probability of the item of this bin
+			float pdf{ 0.f };
+		};
+
+		std::vector<Bin> bin;
+
+	public:
+
+		Alias() {};
+
+		// Weights need not be normalised, all zero (or negative) falls back to uniform
+		Alias(
+			std::vector<double> const& weight
+		)
+		{
+			uint32_t const n = static_cast<uint32_t>( weight.size() );
+			if ( n == 0 )
+				return;
+
+			double total{ 0. };
+			for ( double const w : weight )
+				total += std::max( w, 0. );
+
+			// Scaled so the average bin is 1
+			std::vector<double> scaled( n );
+			bin.resize( n );
+			for ( uint32_t i = 0; i < n; ++i )
+			{
+				double const p = total > 0. ? std::max( weight[ i ], 0. ) / total : 1. / n;
+				bin[ i ].pdf = static_cast<float>( p );
+				scaled[ i ] = p * n;
+			}
+
+			std::vector<uint32_t> small;
+			std::vector<uint32_t> large;
+			for ( uint32_t i = 0; i < n; ++i )
+				( scaled[ i ] < 1. ? small : large ).push_back( i );
+
+			// Fill each small bin up with part of a large one
+			while ( !small.empty() && !large.empty() )
+			{
+				uint32_t const s = small.back();
+				uint32_t const l = large.back();
+				small.pop_back();
+				bin[ s ].threshold = static_cast<float>( scaled[ s ] );
+				bin[ s ].alias = l;
+				scaled[ l ] -= 1. - scaled[ s ];
+				if ( scaled[ l ] < 1. )
+				{
+					large.pop_back();
+					small.push_back( l );
+				}
+			}
+			// Left overs are full up to rounding
+			for ( uint32_t const i : small )
+				bin[ i ].threshold = 1.f;
+			for ( uint32_t const i : large )
+				bin[ i ].threshold = 1.f;
+		};
+
+		// Item and its probability, from one uniform number in [0, 1[
+		std::tuple<uint32_t, float> sample(
+			float const& u
+		) const
+		{
+			uint32_t const n = static_cast<uint32_t>( bin.size() );
+			float const scaled = u * n;
+			uint32_t const i = std::min( static_cast<uint32_t>( scaled ), n - 1 );
+			uint32_t const item = ( scaled - i ) < bin[ i ].threshold ? i : bin[ i ].alias;
+			return { item, bin[ item ].pdf };
+		};
+
+		float pdf( uint32_t const& item ) const { return bin[ item ].pdf; };
+
+		uint32_t size() const { return static_cast<uint32_t>( bin.size() ); };
+
+	};
+
+};
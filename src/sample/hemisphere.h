@@ -4,13 +4,13 @@
 #include <utility>
 
 #include "../mathematics/constant.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 
 namespace Sample
 {
 
-	Double3 HemiSphere( Random::Polymorphic& random )
+	inline Real3 HemiSphere( Random::Polymorphic& random )
 	{
 		auto const [e1, e2] = random.get_float2();
 		float const phi = e1 * two_pi;
@@ -18,5 +18,14 @@ namespace Sample
 		return { std::cos( phi ) * radius, std::sin( phi ) * radius, e2 };
 	};
 
+	// Density cos( theta ) / pi, uniform points on the disc projected up to the hemisphere (Malley's method)
+	inline Real3 CosineHemiSphere( Random::Polymorphic& random )
+	{
+		auto const [e1, e2] = random.get_float2();
+		float const phi = e1 * two_pi;
+		float const radius = std::sqrt( e2 );
+		return { std::cos( phi ) * radius, std::sin( phi ) * radius, std::sqrt( std::max( 0.f, 1.f - e2 ) ) };
+	};
+
 };
 
@@ -4,13 +4,13 @@
 #include <utility>
 
 #include "../mathematics/constant.h"
-#include "../mathematics/double3.h"
+#include "../mathematics/vec3.h"
 #include "../random/polymorphic.h"
 
 namespace Sample
 {
 
-	Double3 Sphere( Random::Polymorphic& random )
+	Real3 Sphere( Random::Polymorphic& random )
 	{
 		auto const [e1, e2] = random.get_float2();
 		float const phi = e1 * two_pi;
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Counters of the hot paths, compiled in with BPT_STATS only, so release builds pay nothing.
+// Each thread counts into its own copy, Render::Image merges them after every pass.
+#ifdef BPT_STATS
+#define BPT_STAT( counter, n ) ( ::Stats::local.value[ static_cast<uint8_t>( ::Stats::Counter::counter ) ] += ( n ) )
+#define BPT_STAT_PATH( histogram, length ) ( ++::Stats::local.histogram[ std::min<uint32_t>( ( length ), ::Stats::n_bin - 1 ) ] )
+#else
+#define BPT_STAT( counter, n ) static_cast<void>( 0 )
+#define BPT_STAT_PATH( histogram, length ) static_cast<void>( 0 )
+#endif
+
+namespace Stats
+{
+
+	enum class Counter : uint8_t
+	{
+		// Closest hit rays, and shadow rays
+		intersect_rays,
+		occluded_rays,
+		// Triangles tested by both, packets count only the lanes that hold a triangle
+		triangle_tests,
+		// Camera vertex to emitter or light subpath vertex
+		connections,
+		// Emitter facing away from the camera vertex
+		rejected_cosine,
+		// Either end reflects nothing towards the other
+		rejected_black,
+		rejected_occluded,
+		count
+	};
+
+	constexpr char const* name[] = { "intersect_rays", "occluded_rays", "triangle_tests", "connections", "rejected_cosine", "rejected_black", "rejected_occluded" };
+
+	// Path lengths in surface vertices, the last bin holds all longer ones
+	constexpr uint32_t n_bin{ 32 };
+
+	// Trivial, so the thread local copy needs no guard on access
+	struct Counters
+	{
+		std::array<uint64_t, static_cast<uint8_t>( Stats::Counter::count )> value{};
+		std::array<uint64_t, n_bin> camera_length{};
+		std::array<uint64_t, n_bin> light_length{};
+
+		Counters& operator += ( Counters const& other )
+		{
+			for ( uint8_t i = 0; i < value.size(); ++i )
+				value[ i ] += other.value[ i ];
+			for ( uint32_t i = 0; i < n_bin; ++i )
+			{
+				camera_length[ i ] += other.camera_length[ i ];
+				light_length[ i ] += other.light_length[ i ];
+			}
+			return *this;
+		};
+
+		uint64_t operator [] ( Stats::Counter const& counter ) const { return value[ static_cast<uint8_t>( counter ) ]; };
+
+		void print() const
+		{
+			for ( uint8_t i = 0; i < value.size(); ++i )
+				std::cout << "  " << Stats::name[ i ] << ": " << value[ i ] << std::endl;
+			uint64_t const rays = ( *this )[ Stats::Counter::intersect_rays ] + ( *this )[ Stats::Counter::occluded_rays ];
+			if ( rays > 0 )
+				std::cout << "  triangles per ray: " << static_cast<double>( ( *this )[ Stats::Counter::triangle_tests ] ) / rays << std::endl;
+			std::cout << "  camera path lengths:";
+			print_histogram( camera_length );
+			std::cout << "  light path lengths:";
+			print_histogram( light_length );
+		};
+
+		bool save(
+			std::string const& file_name
+		) const
+		{
+			std::ofstream file( file_name, std::ios::trunc );
+			if ( !file )
+				return false;
+			file << "{\n\t\"counters\": {";
+			for ( uint8_t i = 0; i < value.size(); ++i )
+				file << ( i ? ", " : " " ) << "\"" << Stats::name[ i ] << "\": " << value[ i ];
+			file << " },\n\t\"camera_path_length\": ";
+			save_histogram( file, camera_length );
+			file << ",\n\t\"light_path_length\": ";
+			save_histogram( file, light_length );
+			file << "\n}\n";
+			return static_cast<bool>( file );
+		};
+
+	private:
+
+		// Up to the last non empty bin
+		static uint32_t used( std::array<uint64_t, n_bin> const& histogram )
+		{
+			uint32_t n{ n_bin };
+			while ( ( n > 0 ) && ( histogram[ n - 1 ] == 0 ) )
+				--n;
+			return n;
+		};
+
+		static void print_histogram( std::array<uint64_t, n_bin> const& histogram )
+		{
+			for ( uint32_t i = 0; i < used( histogram ); ++i )
+				std::cout << " " << i << ":" << histogram[ i ];
+			std::cout << std::endl;
+		};
+
+		static void save_histogram( std::ofstream& file, std::array<uint64_t, n_bin> const& histogram )
+		{
+			file << "[";
+			for ( uint32_t i = 0; i < used( histogram ); ++i )
+				file << ( i ? ", " : " " ) << histogram[ i ];
+			file << " ]";
+		};
+
+	};
+
+	constinit inline thread_local Stats::Counters local{};
+
+	// Counts of this thread so far, which are reset
+	inline Stats::Counters take()
+	{
+		Stats::Counters const counters = local;
+		local = {};
+		return counters;
+	};
+
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timeline of the render phases per thread, compiled in with BPT_TRACE only.
+// Saved as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open.
+#ifdef BPT_TRACE
+#define BPT_TRACE_SCOPE( name ) ::Stats::Scope const bpt_trace_scope( name )
+#define BPT_TRACE_TILE( name, x, y ) ::Stats::Scope const bpt_trace_scope( name, ( x ), ( y ) )
+#else
+#define BPT_TRACE_SCOPE( name ) static_cast<void>( 0 )
+#define BPT_TRACE_TILE( name, x, y ) static_cast<void>( 0 )
+#endif
+
+namespace Stats
+{
+
+	struct Event
+	{
+		// String literal, so events need not own it
+		char const* name{ nullptr };
+		// Micro seconds since the program started
+		double begin{ 0. };
+		double end{ 0. };
+		// Position of a tile, negative for other phases
+		int32_t x{ -1 };
+		int32_t y{ -1 };
+	};
+
+	// Events of every thread that recorded one, each thread appends to its own buffer only
+	class Trace final
+	{
+
+	private:
+
+		std::chrono::steady_clock::time_point const epoch{ std::chrono::steady_clock::now() };
+
+		std::mutex mutex;
+		std::vector<std::unique_ptr<std::vector<Stats::Event>>> buffer;
+
+	public:
+
+		double now() const
+		{
+			return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - epoch ).count();
+		};
+
+		// Buffer of the calling thread, registered on its first event
+		std::vector<Stats::Event>& local()
+		{
+			thread_local std::vector<Stats::Event>* p_local{ nullptr };
+			if ( !p_local )
+			{
+				std::lock_guard<std::mutex> const lock( mutex );
+				buffer.push_back( std::make_unique<std::vector<Stats::Event>>() );
+				p_local = buffer.back().get();
+				p_local->reserve( 4096 );
+			}
+			return *p_local;
+		};
+
+		// Only while no thread records, e.g. after the render.
+		// Threads are numbered in the order of their first event, so the main thread is 0.
+		bool save(
+			std::string const& file_name
+		)
+		{
+			std::lock_guard<std::mutex> const lock( mutex );
+			std::ofstream file( file_name, std::ios::trunc );
+			if ( !file )
+				return false;
+			file << std::fixed;
+			file.precision( 3 );
+			file << "{\n\t\"displayTimeUnit\": \"ms\",\n\t\"traceEvents\": [";
+			bool f_first{ true };
+			for ( size_t t = 0; t < buffer.size(); ++t )
+			{
+				file << ( f_first ? "" : "," ) << "\n\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t << ", \"args\": { \"name\": \"thread " << t << "\" } }";
+				f_first = false;
+				for ( Stats::Event const& e : *buffer[ t ] )
+				{
+					file << ",\n\t\t{ \"name\": \"" << e.name << "\", \"cat\": \"bpt\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t << ", \"ts\": " << e.begin << ", \"dur\": " << e.end - e.begin;
+					if ( e.x >= 0 )
+						file << ", \"args\": { \"x\": " << e.x << ", \"y\": " << e.y << " }";
+					file << " }";
+				}
+			}
+			file << "\n\t]\n}\n";
+			return static_cast<bool>( file );
+		};
+
+	};
+
+	inline Stats::Trace trace;
+
+	// Records the time from construction to destruction as one event
+	class Scope final
+	{
+
+	private:
+
+		Stats::Event event;
+
+	public:
+
+		Scope() = delete;
+		Scope( Scope const& ) = delete;
+		Scope& operator = ( Scope const& ) = delete;
+
+		explicit Scope(
+			char const* name,
+			int32_t const x = -1,
+			int32_t const y = -1
+		)
+			: event{ name, trace.now(), 0., x, y }
+		{};
+
+		~Scope()
+		{
+			event.end = trace.now();
+			trace.local().push_back( event );
+		};
+
+	};
+
+};